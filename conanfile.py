@@ -147,7 +147,7 @@ class AntartarConanFile(ConanFile):
             for file in [
                 file
                 for file in files
-                if file.endswith(".vert") or file.endswith(".frag")
+                if file.endswith((".vert", ".frag", ".comp"))
             ]:
                 shader_path = os.path.normpath(os.path.join(root, file))
                 self.output.info(f"Compiling {shader_path}")
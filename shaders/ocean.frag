@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec3 fragment_normal;
+layout(location = 1) in float fragment_jacobian;
+
+layout(location = 0) out vec4 out_color;
+
+const vec3 sun   = vec3(0.36, 0.80, 0.48);
+const vec3 deep  = vec3(0.01, 0.09, 0.17);
+const vec3 sky   = vec3(0.45, 0.62, 0.80);
+const vec3 white = vec3(0.90, 0.93, 0.95);
+
+void main()
+{
+    vec3 normal   = normalize(fragment_normal);
+    float diffuse = max(dot(normal, sun), 0.0);
+    // steeper faces reflect more of the sky
+    vec3 water = mix(deep, sky, 0.15 + 0.6 * (1.0 - normal.y))
+                 * (0.5 + 0.5 * diffuse);
+    // compressed water, the surface about to fold
+    float foam = 1.0 - smoothstep(0.3, 0.9, fragment_jacobian);
+    out_color  = vec4(mix(water, white, foam), 1.0);
+}
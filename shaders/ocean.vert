@@ -0,0 +1,58 @@
+#version 450
+
+// a grid point of a quadtree node of the ocean moved by the surface
+// gpu_ocean computed this frame; the node's vertices morph onto the next
+// level's grid as they near its range, see quadtree.hpp
+layout(location = 0) in vec2 input_grid;
+// min corner in x and z, meters per side, level
+layout(location = 1) in vec4 input_node;
+
+layout(set = 0, binding = 0) uniform sampler2D displacement;
+
+layout(set = 0, binding = 1) uniform sampler2D normals;
+
+layout(push_constant) uniform camera
+{
+    mat4 view_projection;
+    vec3 eye;
+    float patch_length;
+    // texels per side of the surface
+    float size;
+    // quads per full node side
+    float grid;
+    float leaf_size;
+    // where level 0 is fully morphed
+    float first_range;
+    // how far from half its range a level starts to morph
+    float morph_start;
+};
+
+layout(location = 0) out vec3 fragment_normal;
+layout(location = 1) out float fragment_jacobian;
+
+void main()
+{
+    float level = input_node.w;
+    float cell  = leaf_size * exp2(level) / grid;
+    float range = first_range * exp2(level);
+    float start = range * (0.5 + 0.5 * morph_start);
+    vec2 local  = input_grid * input_node.z;
+    vec2 world  = input_node.xy + local;
+    float morph = clamp(
+        (distance(eye, vec3(world.x, 0.0, world.y)) - start) / (range - start),
+        0.0,
+        1.0);
+    // odd vertices slide onto their even neighbour, halving the grid
+    vec2 odd = mod(round(local / cell), 2.0);
+    world -= odd * cell * morph;
+
+    // texel centers, repeat tiles the patch across the plane
+    vec2 uv       = world / patch_length + 0.5 + 0.5 / size;
+    float lod     = max(log2(cell * size / patch_length) + morph, 0.0);
+    vec4 normal   = textureLod(normals, uv, lod);
+    vec3 position = vec3(world.x, 0.0, world.y)
+                    + textureLod(displacement, uv, lod).xyz;
+    gl_Position       = view_projection * vec4(position, 1.0);
+    fragment_normal   = normal.xyz;
+    fragment_jacobian = normal.w;
+}
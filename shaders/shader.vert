@@ -2,11 +2,18 @@
 
 layout(location = 0) in vec2 input_position;
 layout(location = 1) in vec3 input_color;
+// xy offset, zw scale
+layout(location = 2) in vec4 instance_transform;
+layout(location = 3) in vec4 instance_tint;
+layout(location = 4) in float instance_depth;
 
 layout(location = 0) out vec3 fragment_color;
 
 void main()
 {
-    gl_Position    = vec4(input_position, 0.0, 1.0);
-    fragment_color = input_color;
+    gl_Position = vec4(
+        input_position * instance_transform.zw + instance_transform.xy,
+        instance_depth,
+        1.0);
+    fragment_color = input_color * instance_tint.rgb;
 }
@@ -1,7 +1,322 @@
 #include <antartar/app.hpp>
+#include <antartar/benchmark.hpp>
+#include <antartar/culling.hpp>
+#include <antartar/file.hpp>
+#include <antartar/jobs.hpp>
+#include <antartar/mesh.hpp>
+#include <antartar/ocean.hpp>
+#include <antartar/profiler.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fmt/format.h>
+#include <numbers>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
 
 namespace antartar {
+namespace {
+// tiles x tiles quads covering the viewport, shades of blue so neighbours
+// stay apart; further layers repeat the grid behind the first one, fully
+// hidden, front to back
+auto ocean_tiles(uint32_t tiles, uint32_t layers)
+{
+    std::vector<vk::instance> instances;
+    instances.reserve(size_t{tiles} * tiles * layers);
+    const auto size = 2.f / static_cast<float>(tiles);
+    for (uint32_t layer = 0; layer < layers; ++layer) {
+        const auto depth = static_cast<float>(layer + 1)
+                           / static_cast<float>(layers + 1);
+        for (uint32_t y = 0; y < tiles; ++y) {
+            for (uint32_t x = 0; x < tiles; ++x) {
+                const auto shade =
+                    0.5f + 0.25f * static_cast<float>((x + y) % 3);
+                instances.push_back(
+                    {.transform = {-1.f + (static_cast<float>(x) + .5f) * size,
+                                   -1.f + (static_cast<float>(y) + .5f) * size,
+                                   size,
+                                   size},
+                     .tint      = {0.1f, 0.3f * shade, shade, 1.f},
+                     .depth     = depth});
+            }
+        }
+    }
+    return instances;
+}
+
+// what an imported mesh typically carries per vertex
+struct mesh_vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+struct test_mesh {
+    std::vector<mesh_vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// quads x quads in rows, the order the gpu ocean's grid had before it went
+// through the optimizer
+auto grid_mesh(uint32_t quads)
+{
+    test_mesh result;
+    const auto step = 1.f / static_cast<float>(quads);
+    for (uint32_t z = 0; z <= quads; ++z) {
+        for (uint32_t x = 0; x <= quads; ++x) {
+            const glm::vec2 uv{static_cast<float>(x) * step,
+                               static_cast<float>(z) * step};
+            result.vertices.push_back({.position = {uv.x, 0.f, uv.y},
+                                       .normal   = {0.f, 1.f, 0.f},
+                                       .uv       = uv});
+        }
+    }
+    for (uint32_t z = 0; z < quads; ++z) {
+        for (uint32_t x = 0; x < quads; ++x) {
+            const auto corner = z * (quads + 1) + x;
+            const auto below  = corner + quads + 1;
+            result.indices.insert(std::end(result.indices),
+                                  {corner, below, corner + 1,
+                                   corner + 1, below, below + 1});
+        }
+    }
+    return result;
+}
+
+// a unit sphere of rings x segments quads with its triangles and vertices
+// shuffled, like a mesh exported without any care for order
+auto shuffled_sphere_mesh(uint32_t rings, uint32_t segments)
+{
+    test_mesh sphere;
+    for (uint32_t r = 0; r <= rings; ++r) {
+        for (uint32_t s = 0; s <= segments; ++s) {
+            const glm::vec2 uv{
+                static_cast<float>(s) / static_cast<float>(segments),
+                static_cast<float>(r) / static_cast<float>(rings)};
+            const auto theta = std::numbers::pi_v<float> * uv.y;
+            const auto phi   = 2.f * std::numbers::pi_v<float> * uv.x;
+            const glm::vec3 position{std::sin(theta) * std::cos(phi),
+                                     std::cos(theta),
+                                     std::sin(theta) * std::sin(phi)};
+            sphere.vertices.push_back(
+                {.position = position, .normal = position, .uv = uv});
+        }
+    }
+    for (uint32_t r = 0; r < rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            const auto corner = r * (segments + 1) + s;
+            const auto below  = corner + segments + 1;
+            sphere.indices.insert(std::end(sphere.indices),
+                                  {corner, below, corner + 1,
+                                   corner + 1, below, below + 1});
+        }
+    }
+    // the same seed every run
+    std::mt19937 random{42};
+    std::vector<uint32_t> triangles(sphere.indices.size() / 3);
+    std::iota(std::begin(triangles), std::end(triangles), 0u);
+    std::ranges::shuffle(triangles, random);
+    std::vector<uint32_t> moved_to(sphere.vertices.size());
+    std::iota(std::begin(moved_to), std::end(moved_to), 0u);
+    std::ranges::shuffle(moved_to, random);
+    test_mesh result{.vertices = sphere.vertices};
+    for (size_t v = 0; v < sphere.vertices.size(); ++v) {
+        result.vertices[moved_to[v]] = sphere.vertices[v];
+    }
+    for (const auto t : triangles) {
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            result.indices.push_back(moved_to[sphere.indices[3 * t + corner]]);
+        }
+    }
+    return result;
+}
+
+// warmup frames are drawn but not recorded; frame time is measured from the
+// start of one frame to the start of the next, so it covers event polling too
+template<typename TargetT>
+auto run_benchmark(TargetT& target, const options& opts, auto next_frame)
+{
+    using clock        = std::chrono::steady_clock;
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    benchmark::recorder recorder{opts.frames};
+
+    for (uint64_t frame = 0; frame < opts.warmup and next_frame(); ++frame) {
+        target.draw_frame();
+    }
+    // startup uploads retire during warmup
+    target.take_gpu_upload_milliseconds();
+    uint64_t measured = 0;
+    auto previous     = clock::now();
+    for (; measured < opts.frames and next_frame(); ++measured) {
+        target.draw_frame();
+        const auto now     = clock::now();
+        const auto timings = target.last_frame_timings();
+        recorder.add("frame", milliseconds{now - previous}.count());
+        recorder.add("acquire", timings.acquire.count());
+        recorder.add("record", timings.record.count());
+        recorder.add("submit", timings.submit.count());
+        recorder.add("present", timings.present.count());
+        if (timings.input_to_present) {
+            recorder.add("input_to_present",
+                         timings.input_to_present->count());
+        }
+        for (const auto& zone : target.gpu_frame_timings()) {
+            recorder.add(fmt::format("gpu_{}", zone.name), zone.milliseconds);
+        }
+        // uploads are rare, only frames that retired one contribute
+        if (const auto upload = target.take_gpu_upload_milliseconds();
+            upload > 0.) {
+            recorder.add("gpu_upload", upload);
+        }
+        previous = now;
+    }
+    target.wait_idle();
+
+    const auto startup = target.startup();
+    recorder.annotate("mode", opts.headless ? "\"headless\"" : "\"window\"");
+    recorder.annotate("width", fmt::format("{}", opts.width));
+    recorder.annotate("height", fmt::format("{}", opts.height));
+    recorder.annotate("warmup_frames", fmt::format("{}", opts.warmup));
+    recorder.annotate("measured_frames", fmt::format("{}", measured));
+    recorder.annotate("startup_ms",
+                      fmt::format("{:.4f}", startup.total.count()));
+    recorder.annotate("warm_pipeline_cache",
+                      startup.warm_pipeline_cache ? "true" : "false");
+    const auto pacing = target.pacing();
+    recorder.annotate(
+        "latency_mode",
+        fmt::format("\"{}\"", vk::latency_mode_name(pacing.mode)));
+    recorder.annotate("frames_in_flight",
+                      fmt::format("{}", pacing.frames_in_flight));
+    if (const auto present_mode = target.present_mode()) {
+        recorder.annotate(
+            "present_mode",
+            fmt::format("\"{}\"", vk::present_mode_name(*present_mode)));
+    }
+    recorder.annotate("present_wait",
+                      pacing.wait_for_present ? "true" : "false");
+    recorder.annotate("tiles", fmt::format("{}", opts.tiles));
+    recorder.annotate("layers", fmt::format("{}", opts.layers));
+    recorder.annotate("draw_calls", fmt::format("{}", target.draw_calls()));
+    recorder.annotate("draw_path", fmt::format("\"{}\"", target.draw_path()));
+    recorder.annotate("occlusion_culling",
+                      target.culls_occluded() ? "true" : "false");
+    recorder.annotate("cpu_ocean", fmt::format("{}", opts.cpu_ocean));
+    recorder.annotate("gpu_ocean", fmt::format("{}", opts.gpu_ocean));
+    if (opts.gpu_ocean > 0) {
+        recorder.annotate("ocean_vertices",
+                          fmt::format("{}", target.gpu_ocean_vertices()));
+    }
+    if (opts.resize_storm > 0 and not opts.headless) {
+        recorder.annotate("resize_every",
+                          fmt::format("{}", opts.resize_storm));
+    }
+    return recorder;
+}
+
+auto report(benchmark::recorder& recorder, const options& opts)
+{
+    const auto json = recorder.to_json();
+    if (opts.output.empty()) {
+        fmt::print("{}", json);
+        return;
+    }
+    if (file::write(opts.output, std::as_bytes(std::span{json}))
+        != file::status::ok) {
+        throw std::runtime_error(log_message(
+            fmt::format("failed to write benchmark results to {}",
+                        opts.output)));
+    }
+    log("benchmark results written to {}", opts.output);
+}
+
+// largest difference against the cpu side, relative to the largest cpu
+// magnitude of the field
+struct ocean_error {
+    float difference = 0.f;
+    float magnitude  = 0.f;
+
+    auto add(float gpu, float cpu)
+    {
+        difference = std::max(difference, std::abs(gpu - cpu));
+        magnitude  = std::max(magnitude, std::abs(cpu));
+    }
+
+    auto relative() const
+    {
+        return magnitude > 0.f ? difference / magnitude : difference;
+    }
+};
+
+// one frame of the gpu ocean against ocean::simulation at the same time,
+// the jacobian from the same central differences ocean_surface.comp takes;
+// the surface is stored as halves, anything past a percent is a bug
+void check_gpu_ocean(headless& offscreen)
+{
+    constexpr auto tolerance = 1e-2f;
+    offscreen.capture_gpu_ocean();
+    offscreen.draw_frame();
+    offscreen.wait_idle();
+    const auto capture = offscreen.gpu_ocean_capture();
+    if (not capture) {
+        throw std::runtime_error(
+            log_message("the gpu ocean frame was never captured"sv));
+    }
+    const auto& parameters = offscreen.gpu_ocean_parameters();
+    ocean::simulation simulation{parameters};
+    std::vector<ocean::sample> samples(simulation.sample_count());
+    simulation.simulate(capture->time, samples, jobs::global_scheduler());
+
+    const auto n       = static_cast<int64_t>(parameters.size);
+    const auto spacing = parameters.patch_length / static_cast<float>(n);
+    auto displacement_at = [&](int64_t x, int64_t z) {
+        return samples[static_cast<size_t>((z & (n - 1)) * n + (x & (n - 1)))]
+            .displacement;
+    };
+    ocean_error displacement, normal, jacobian;
+    for (int64_t z = 0; z < n; ++z) {
+        for (int64_t x = 0; x < n; ++x) {
+            const auto i       = static_cast<size_t>(z * n + x);
+            const auto& sample = samples[i];
+            const auto& gpu_displacement = capture->displacement[i];
+            const auto& gpu_normal       = capture->normals[i];
+            const auto cpu_normal        = glm::normalize(
+                glm::vec3{-sample.slope.x, 1.f, -sample.slope.y});
+            for (int c = 0; c < 3; ++c) {
+                displacement.add(gpu_displacement[c], sample.displacement[c]);
+                normal.add(gpu_normal[c], cpu_normal[c]);
+            }
+            const auto right = displacement_at(x + 1, z);
+            const auto left  = displacement_at(x - 1, z);
+            const auto up    = displacement_at(x, z + 1);
+            const auto down  = displacement_at(x, z - 1);
+            const auto dx_dx = (right.x - left.x) / (2.f * spacing);
+            const auto dz_dx = (right.z - left.z) / (2.f * spacing);
+            const auto dx_dz = (up.x - down.x) / (2.f * spacing);
+            const auto dz_dz = (up.z - down.z) / (2.f * spacing);
+            jacobian.add(gpu_normal.w,
+                         (1.f + dx_dx) * (1.f + dz_dz) - dz_dx * dx_dz);
+        }
+    }
+    log("gpu ocean of size {} at {:.3f} s against the cpu: displacement "
+        "{:.2e} m of {:.2f} m, normal {:.2e}, jacobian {:.2e} of {:.2f}",
+        n,
+        capture->time,
+        displacement.difference,
+        displacement.magnitude,
+        normal.difference,
+        jacobian.difference,
+        jacobian.magnitude);
+    if (displacement.relative() > tolerance or normal.relative() > tolerance
+        or jacobian.relative() > tolerance) {
+        throw std::runtime_error(
+            log_message("gpu ocean differs from the cpu simulation"sv));
+    }
+}
+} // namespace
+
 void app::run()
 {
     fmt::print("running antartar\n");
@@ -10,14 +325,364 @@ void app::run()
     vkEnumerateInstanceExtensionProperties(nullptr,
                                            std::addressof(extension_count),
                                            nullptr);
-    log(fmt::format("vulkan supports {} extensions", extension_count));
+    log("vulkan supports {} extensions", extension_count);
+
+    if (options_.jobs_benchmark) {
+        run_jobs_benchmark_();
+    }
+    else if (options_.culling_benchmark) {
+        run_culling_benchmark_();
+    }
+    else if (options_.ocean_benchmark) {
+        run_ocean_benchmark_();
+    }
+    else if (options_.mesh_benchmark) {
+        run_mesh_benchmark_();
+    }
+    else if (options_.headless) {
+        run_headless_();
+    }
+    else {
+        run_windowed_();
+    }
+
+    if (not options_.trace.empty()) {
+        const auto trace = profiler::chrome_trace();
+        if (file::write(options_.trace, std::as_bytes(std::span{trace}))
+            != file::status::ok) {
+            throw std::runtime_error(log_message(fmt::format(
+                "failed to write profiling trace to {}", options_.trace)));
+        }
+        log("profiling trace written to {}", options_.trace);
+    }
+}
 
-    while (!glfwWindowShouldClose(window_)) {
+void app::run_windowed_()
+{
+    window main_window{
+        options_.width, options_.height, "antartar", options_.pacing};
+    main_window.set_indirect(options_.indirect);
+    main_window.set_occlusion(options_.occlusion);
+    if (options_.cpu_ocean > 0) {
+        main_window.simulate_ocean({.size = options_.cpu_ocean});
+    }
+    if (options_.gpu_ocean > 0) {
+        main_window.simulate_gpu_ocean({.size = options_.gpu_ocean});
+    }
+    if (options_.tiles > 0) {
+        main_window.set_instances(ocean_tiles(options_.tiles, options_.layers),
+                                  options_.instancing);
+    }
+    if (options_.benchmark) {
+        uint64_t frame = 0;
+        auto recorder  = run_benchmark(main_window, options_, [&] {
+            // alternates between the requested size and three quarters of
+            // it, every resize recreates the swap chain
+            if (options_.resize_storm > 0
+                and ++frame % options_.resize_storm == 0) {
+                const auto shrink = frame / options_.resize_storm % 2 == 1;
+                glfwSetWindowSize(
+                    main_window,
+                    static_cast<int>(shrink ? options_.width * 3 / 4
+                                            : options_.width),
+                    static_cast<int>(shrink ? options_.height * 3 / 4
+                                            : options_.height));
+            }
+            glfwPollEvents();
+            return !glfwWindowShouldClose(main_window);
+        });
+        report(recorder, options_);
+        return;
+    }
+    for (uint64_t frame = 0;
+         !glfwWindowShouldClose(main_window)
+         and (options_.frames == 0 or frame < options_.frames);
+         ++frame) {
         glfwPollEvents();
-        draw_frame_();
+        main_window.draw_frame();
+    }
+    main_window.wait_idle();
+}
+
+void app::run_headless_()
+{
+    headless offscreen{options_.width,
+                       options_.height,
+                       options_.readback,
+                       options_.pacing};
+    offscreen.set_indirect(options_.indirect);
+    offscreen.set_occlusion(options_.occlusion);
+    if (options_.cpu_ocean > 0) {
+        offscreen.simulate_ocean({.size = options_.cpu_ocean});
+    }
+    if (options_.gpu_ocean > 0) {
+        offscreen.simulate_gpu_ocean({.size = options_.gpu_ocean});
+    }
+    if (options_.check_ocean) {
+        check_gpu_ocean(offscreen);
+        return;
+    }
+    if (options_.tiles > 0) {
+        offscreen.set_instances(ocean_tiles(options_.tiles, options_.layers),
+                                options_.instancing);
+    }
+    if (options_.benchmark) {
+        auto recorder =
+            run_benchmark(offscreen, options_, [] { return true; });
+        report(recorder, options_);
+        return;
+    }
+    for (uint64_t frame = 0; frame < options_.frames; ++frame) {
+        offscreen.draw_frame();
+    }
+    offscreen.wait_idle();
+    if (options_.readback) {
+        log("read back {} frames, last frame hash {:016x}",
+            offscreen.target().frames_presented(),
+            offscreen.target().last_frame_hash());
     }
-    window_.wait_idle();
 }
 
-void app::draw_frame_() { window_.draw_frame(); }
-} // namespace antartar
\ No newline at end of file
+// cpu bound stand-in for per object frame work like animation or culling,
+// heavy enough to amortize scheduling, split fine enough to need stealing
+void app::run_jobs_benchmark_()
+{
+    using clock                 = std::chrono::steady_clock;
+    using milliseconds          = std::chrono::duration<double, std::milli>;
+    constexpr size_t item_count = 1 << 16;
+    constexpr size_t grain      = 256;
+    constexpr int iterations    = 8;
+
+    std::vector<float> items(item_count, 1.f);
+    auto work = [&](size_t first, size_t last) {
+        for (auto i = first; i < last; ++i) {
+            auto x = items[i];
+            for (int n = 0; n < iterations; ++n) {
+                x = x * 0.999f + std::sin(x);
+            }
+            items[i] = x;
+        }
+    };
+
+    const auto hardware_threads =
+        std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> worker_counts;
+    for (uint32_t workers = 1; workers < hardware_threads; workers *= 2) {
+        worker_counts.push_back(workers);
+    }
+    worker_counts.push_back(hardware_threads);
+
+    benchmark::recorder recorder{options_.frames};
+    recorder.annotate("mode", "\"jobs\"");
+    recorder.annotate("hardware_threads",
+                      fmt::format("{}", hardware_threads));
+    recorder.annotate("item_count", fmt::format("{}", item_count));
+    recorder.annotate("grain", fmt::format("{}", grain));
+    double single_worker_p50 = 0.;
+    for (const auto workers : worker_counts) {
+        jobs::scheduler scheduler{workers};
+        for (uint64_t run = 0; run < options_.warmup; ++run) {
+            scheduler.parallel_for(item_count, grain, work);
+        }
+        std::vector<double> samples;
+        samples.reserve(options_.frames);
+        for (uint64_t run = 0; run < options_.frames; ++run) {
+            const auto start = clock::now();
+            scheduler.parallel_for(item_count, grain, work);
+            samples.push_back(milliseconds{clock::now() - start}.count());
+            recorder.add(fmt::format("workers_{}", workers), samples.back());
+        }
+        const auto p50 = benchmark::summarize(samples).p50;
+        if (workers == 1) {
+            single_worker_p50 = p50;
+        }
+        recorder.annotate(fmt::format("speedup_{}", workers),
+                          fmt::format("{:.3f}", single_worker_p50 / p50));
+    }
+    // keeps the work observable
+    recorder.annotate(
+        "checksum",
+        fmt::format("{:.3f}",
+                    std::accumulate(std::begin(items), std::end(items), 0.)));
+    report(recorder, options_);
+}
+
+void app::run_culling_benchmark_()
+{
+    using clock                 = std::chrono::steady_clock;
+    using milliseconds          = std::chrono::duration<double, std::milli>;
+    constexpr size_t item_count = 1 << 20;
+
+    // bounds scattered over twice the view volume so roughly a quarter
+    // survives, the same seed every run
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> coordinate{-2.f, 2.f};
+    std::uniform_real_distribution<float> size{.001f, .05f};
+    culling::sphere_set spheres;
+    culling::box_set boxes;
+    spheres.reserve(item_count);
+    boxes.reserve(item_count);
+    for (size_t i = 0; i < item_count; ++i) {
+        const glm::vec3 center{
+            coordinate(random), coordinate(random), coordinate(random)};
+        const auto extent = size(random);
+        spheres.push(center, extent);
+        boxes.push(center - extent, center + extent);
+    }
+    const auto view = culling::extract_frustum(glm::mat4{1.f});
+
+    const auto supported = supported_simd_level();
+    benchmark::recorder recorder{options_.frames};
+    recorder.annotate("mode", "\"culling\"");
+    recorder.annotate(
+        "simd_level",
+        fmt::format("\"{}\"", simd_level_name(supported)));
+    recorder.annotate("item_count", fmt::format("{}", item_count));
+    std::vector<uint32_t> visible;
+    auto measure = [&](const auto& set,
+                       std::string_view kind,
+                       simd_level level) {
+        const auto name =
+            fmt::format("{}_{}", kind, simd_level_name(level));
+        for (uint64_t run = 0; run < options_.warmup; ++run) {
+            culling::cull(view, set, visible, level);
+        }
+        std::vector<double> samples;
+        samples.reserve(options_.frames);
+        for (uint64_t run = 0; run < options_.frames; ++run) {
+            const auto start = clock::now();
+            culling::cull(view, set, visible, level);
+            samples.push_back(milliseconds{clock::now() - start}.count());
+            recorder.add(name, samples.back());
+        }
+        const auto p50 = benchmark::summarize(samples).p50;
+        recorder.annotate(fmt::format("{}_per_ms", name),
+                          fmt::format("{:.0f}", item_count / p50));
+        recorder.annotate(fmt::format("{}_visible", name),
+                          fmt::format("{}", visible.size()));
+    };
+    for (const auto level : {simd_level::scalar,
+                             simd_level::sse,
+                             simd_level::avx2}) {
+        if (level > supported) {
+            break;
+        }
+        measure(spheres, "spheres"sv, level);
+        measure(boxes, "boxes"sv, level);
+    }
+    report(recorder, options_);
+}
+
+void app::run_ocean_benchmark_()
+{
+    using clock        = std::chrono::steady_clock;
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    constexpr auto frame_seconds = 1. / 60.;
+
+    auto& workers        = jobs::global_scheduler();
+    const auto supported = supported_simd_level();
+    benchmark::recorder recorder{options_.frames};
+    recorder.annotate("mode", "\"ocean\"");
+    recorder.annotate(
+        "simd_level",
+        fmt::format("\"{}\"", simd_level_name(supported)));
+    recorder.annotate("workers", fmt::format("{}", workers.worker_count()));
+    std::vector<ocean::sample> samples;
+    for (const uint32_t size : {256u, 512u, 1024u}) {
+        ocean::simulation simulation{{.size = size}};
+        samples.resize(simulation.sample_count());
+        // sse has no kernels of its own, it runs the scalar ones
+        for (const auto level : {simd_level::scalar, simd_level::avx2}) {
+            if (level > supported) {
+                break;
+            }
+            const auto name =
+                fmt::format("ocean_{}_{}", size, simd_level_name(level));
+            // consecutive frames of a running simulation
+            auto time = 0.;
+            auto step = [&] {
+                simulation.simulate(time, samples, workers, level);
+                time += frame_seconds;
+            };
+            for (uint64_t run = 0; run < options_.warmup; ++run) {
+                step();
+            }
+            for (uint64_t run = 0; run < options_.frames; ++run) {
+                const auto start = clock::now();
+                step();
+                recorder.add(name, milliseconds{clock::now() - start}.count());
+            }
+        }
+    }
+    report(recorder, options_);
+}
+
+void app::run_mesh_benchmark_()
+{
+    using clock        = std::chrono::steady_clock;
+    using milliseconds = std::chrono::duration<double, std::milli>;
+
+    benchmark::recorder recorder{options_.frames};
+    recorder.annotate("mode", "\"mesh\"");
+    recorder.annotate("cache_size",
+                      fmt::format("{}", mesh::default_cache_size));
+    auto annotate_stats = [&](std::string_view name,
+                              std::string_view when,
+                              const test_mesh& m) {
+        const auto indices = std::span<const uint32_t>{m.indices};
+        const auto cache =
+            mesh::analyze_vertex_cache(indices, m.vertices.size());
+        const auto fetch = mesh::analyze_vertex_fetch(
+            indices, m.vertices.size(), sizeof(mesh_vertex));
+        recorder.annotate(fmt::format("{}_acmr_{}", name, when),
+                          fmt::format("{:.4f}", cache.acmr));
+        recorder.annotate(fmt::format("{}_atvr_{}", name, when),
+                          fmt::format("{:.4f}", cache.atvr));
+        recorder.annotate(fmt::format("{}_overfetch_{}", name, when),
+                          fmt::format("{:.4f}", fetch.overfetch));
+    };
+    for (const auto& [name, source] :
+         {std::pair{"grid"sv, grid_mesh(256)},
+          std::pair{"sphere"sv, shuffled_sphere_mesh(128, 256)}}) {
+        recorder.annotate(fmt::format("{}_triangles", name),
+                          fmt::format("{}", source.indices.size() / 3));
+        annotate_stats(name, "before"sv, source);
+        // each step runs on the previous one's output, copies aren't timed
+        test_mesh m;
+        std::vector<glm::vec3> positions;
+        auto run = [&](bool measured) {
+            m                = source;
+            const auto start = clock::now();
+            mesh::optimize_vertex_cache(std::span{m.indices},
+                                        m.vertices.size());
+            const auto cached = clock::now();
+            positions.clear();
+            for (const auto& v : m.vertices) {
+                positions.push_back(v.position);
+            }
+            const auto overdraw_start = clock::now();
+            mesh::optimize_overdraw(std::span{m.indices},
+                                    std::span<const glm::vec3>{positions});
+            const auto overdrawn = clock::now();
+            mesh::optimize_vertex_fetch(std::span{m.indices}, m.vertices);
+            const auto fetched = clock::now();
+            if (measured) {
+                recorder.add(fmt::format("{}_vertex_cache", name),
+                             milliseconds{cached - start}.count());
+                recorder.add(fmt::format("{}_overdraw", name),
+                             milliseconds{overdrawn - overdraw_start}.count());
+                recorder.add(fmt::format("{}_vertex_fetch", name),
+                             milliseconds{fetched - overdrawn}.count());
+            }
+        };
+        for (uint64_t i = 0; i < options_.warmup; ++i) {
+            run(false);
+        }
+        for (uint64_t i = 0; i < options_.frames; ++i) {
+            run(true);
+        }
+        annotate_stats(name, "after"sv, m);
+    }
+    report(recorder, options_);
+}
+} // namespace antartar
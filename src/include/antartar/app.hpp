@@ -1,19 +1,23 @@
 #pragma once
 
+#include <antartar/headless.hpp>
+#include <antartar/options.hpp>
 #include <antartar/window.hpp>
 
 namespace antartar {
 class app {
-  public:
-    static constexpr auto WINDOW_WIDTH  = 800;
-    static constexpr auto WINDOW_HEIGHT = 600;
-
   private:
-    window window_{WINDOW_WIDTH, WINDOW_HEIGHT, "antartar"};
-    void draw_frame_();
+    options options_;
+
+    void run_windowed_();
+    void run_headless_();
+    void run_jobs_benchmark_();
+    void run_culling_benchmark_();
+    void run_ocean_benchmark_();
+    void run_mesh_benchmark_();
 
   public:
     void run();
-    app() = default;
+    inline app(const options& opts) : options_{opts} {}
 };
 } // namespace antartar
\ No newline at end of file
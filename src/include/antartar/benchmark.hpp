@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace antartar::benchmark {
+struct summary {
+    double p50  = 0.;
+    double p95  = 0.;
+    double p99  = 0.;
+    double max  = 0.;
+    double mean = 0.;
+};
+
+// nearest-rank percentiles, samples are sorted in place
+inline auto summarize(std::vector<double>& samples) -> summary
+{
+    if (samples.empty()) {
+        return {};
+    }
+    std::ranges::sort(samples);
+    auto percentile = [&](double p) {
+        const auto rank = static_cast<size_t>(
+            std::ceil(p / 100. * static_cast<double>(samples.size())));
+        return samples.at(std::clamp<size_t>(rank, 1, samples.size()) - 1);
+    };
+    return {.p50  = percentile(50.),
+            .p95  = percentile(95.),
+            .p99  = percentile(99.),
+            .max  = samples.back(),
+            .mean = std::accumulate(std::begin(samples), std::end(samples), 0.)
+                    / static_cast<double>(samples.size())};
+}
+
+// named series of per-frame durations in milliseconds, written as json with
+// one object per series so results of two commits can be diffed line by line
+class recorder {
+  private:
+    struct series {
+        std::string name;
+        std::vector<double> samples;
+    };
+    std::vector<series> series_;
+    std::vector<std::pair<std::string, std::string>> metadata_;
+    size_t expected_samples_ = 0;
+
+    inline auto find_(std::string_view name) -> series&
+    {
+        auto it = std::ranges::find(series_, name, &series::name);
+        if (it == std::end(series_)) {
+            series_.push_back({.name = std::string{name}});
+            series_.back().samples.reserve(expected_samples_);
+            return series_.back();
+        }
+        return *it;
+    }
+
+  public:
+    inline recorder(size_t expected_samples)
+        : expected_samples_{expected_samples}
+    {
+    }
+
+    inline auto add(std::string_view name, double milliseconds)
+    {
+        find_(name).samples.push_back(milliseconds);
+    }
+
+    // values are written verbatim, strings have to be quoted by the caller
+    inline auto annotate(std::string_view key, std::string value)
+    {
+        metadata_.emplace_back(std::string{key}, std::move(value));
+    }
+
+    inline auto to_json() -> std::string
+    {
+        std::string json = "{\n";
+        for (const auto& [key, value] : metadata_) {
+            json += fmt::format("    \"{}\": {},\n", key, value);
+        }
+        json += "    \"series_ms\": {";
+        for (auto first = true; auto& [name, samples] : series_) {
+            const auto s = summarize(samples);
+            json += fmt::format("{}\n        \"{}\": {{\"p50\": {:.4f}, "
+                                "\"p95\": {:.4f}, \"p99\": {:.4f}, "
+                                "\"max\": {:.4f}, \"mean\": {:.4f}}}",
+                                first ? "" : ",",
+                                name,
+                                s.p50,
+                                s.p95,
+                                s.p99,
+                                s.max,
+                                s.mean);
+            first = false;
+        }
+        json += "\n    }\n}\n";
+        return json;
+    }
+};
+} // namespace antartar::benchmark
@@ -0,0 +1,404 @@
+#pragma once
+#include <antartar/simd.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string_view>
+#include <vector>
+
+namespace antartar::culling {
+// planes as (normal, distance) pointing inwards, normalized so distances
+// compare against radii
+struct frustum {
+    std::array<glm::vec4, 6> planes;
+};
+
+// Gribb and Hartmann on a vulkan clip space matrix, depth in [0, 1]
+inline auto extract_frustum(const glm::mat4& view_projection) -> frustum
+{
+    auto row = [&](int r) {
+        return glm::vec4{view_projection[0][r],
+                         view_projection[1][r],
+                         view_projection[2][r],
+                         view_projection[3][r]};
+    };
+    const auto x = row(0);
+    const auto y = row(1);
+    const auto z = row(2);
+    const auto w = row(3);
+    frustum result{
+        .planes = {w + x, w - x, w + y, w - y, z, w - z}
+    };
+    for (auto& plane : result.planes) {
+        plane = plane
+                / std::sqrt(plane.x * plane.x + plane.y * plane.y
+                            + plane.z * plane.z);
+    }
+    return result;
+}
+
+// structure of arrays, every coordinate is its own contiguous stream so a
+// register holds the same coordinate of 4 or 8 volumes
+struct sphere_set {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    auto size() const { return x.size(); }
+
+    inline auto reserve(size_t count)
+    {
+        for (auto* stream : {&x, &y, &z, &radius}) {
+            stream->reserve(count);
+        }
+    }
+
+    inline auto clear()
+    {
+        for (auto* stream : {&x, &y, &z, &radius}) {
+            stream->clear();
+        }
+    }
+
+    inline auto push(glm::vec3 center, float r)
+    {
+        x.push_back(center.x);
+        y.push_back(center.y);
+        z.push_back(center.z);
+        radius.push_back(r);
+    }
+};
+
+// kept as center and half extent, the plane test is then one dot product
+// with the center plus one with the absolute normal
+struct box_set {
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> extent_x;
+    std::vector<float> extent_y;
+    std::vector<float> extent_z;
+
+    auto size() const { return center_x.size(); }
+
+    inline auto reserve(size_t count)
+    {
+        for (auto* stream : {&center_x,
+                             &center_y,
+                             &center_z,
+                             &extent_x,
+                             &extent_y,
+                             &extent_z}) {
+            stream->reserve(count);
+        }
+    }
+
+    inline auto clear()
+    {
+        for (auto* stream : {&center_x,
+                             &center_y,
+                             &center_z,
+                             &extent_x,
+                             &extent_y,
+                             &extent_z}) {
+            stream->clear();
+        }
+    }
+
+    inline auto push(glm::vec3 min, glm::vec3 max)
+    {
+        center_x.push_back((min.x + max.x) * .5f);
+        center_y.push_back((min.y + max.y) * .5f);
+        center_z.push_back((min.z + max.z) * .5f);
+        extent_x.push_back((max.x - min.x) * .5f);
+        extent_y.push_back((max.y - min.y) * .5f);
+        extent_z.push_back((max.z - min.z) * .5f);
+    }
+};
+
+namespace detail {
+inline auto sphere_visible(const frustum& f, const sphere_set& s, size_t i)
+{
+    // same order of operations as the simd kernels, results match exactly
+    for (const auto& p : f.planes) {
+        const auto distance =
+            (p.x * s.x[i] + p.y * s.y[i]) + (p.z * s.z[i] + p.w);
+        if (distance < -s.radius[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline auto box_visible(const frustum& f, const box_set& b, size_t i)
+{
+    for (const auto& p : f.planes) {
+        const auto distance = (p.x * b.center_x[i] + p.y * b.center_y[i])
+                              + (p.z * b.center_z[i] + p.w);
+        const auto reach = std::abs(p.x) * b.extent_x[i]
+                           + std::abs(p.y) * b.extent_y[i]
+                           + std::abs(p.z) * b.extent_z[i];
+        if (distance + reach < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline auto cull_scalar(const auto& f,
+                        const auto& set,
+                        auto visible_at,
+                        size_t first,
+                        uint32_t* out) -> size_t
+{
+    size_t count = 0;
+    for (auto i = first; i < set.size(); ++i) {
+        if (visible_at(f, set, i)) {
+            out[count++] = static_cast<uint32_t>(i);
+        }
+    }
+    return count;
+}
+
+#if ANTARTAR_SIMD_X86
+// lane indices of every 8 bit mask moved to the front, compacts a whole
+// register of results with one load and one add
+constexpr auto make_compaction_table()
+{
+    std::array<std::array<uint32_t, 8>, 256> table{};
+    for (uint32_t mask = 0; mask < table.size(); ++mask) {
+        uint32_t count = 0;
+        for (uint32_t lane = 0; lane < 8; ++lane) {
+            if ((mask & (1u << lane)) != 0) {
+                table[mask][count++] = lane;
+            }
+        }
+    }
+    return table;
+}
+
+alignas(32) inline constexpr auto compaction_table = make_compaction_table();
+
+inline auto append_lanes(uint32_t mask, size_t base, uint32_t* out)
+{
+    size_t count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        out[count++] = static_cast<uint32_t>(base + std::countr_zero(mask));
+    }
+    return count;
+}
+
+inline auto cull_spheres_sse(const frustum& f,
+                             const sphere_set& s,
+                             uint32_t* out) -> size_t
+{
+    // broadcast once, the planes stay in registers across the loop
+    __m128 planes[6][4];
+    for (size_t p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            planes[p][c] = _mm_set1_ps(f.planes[p][c]);
+        }
+    }
+    size_t count = 0;
+    size_t i     = 0;
+    for (; i + 4 <= s.size(); i += 4) {
+        const auto x          = _mm_loadu_ps(s.x.data() + i);
+        const auto y          = _mm_loadu_ps(s.y.data() + i);
+        const auto z          = _mm_loadu_ps(s.z.data() + i);
+        const auto neg_radius = _mm_sub_ps(_mm_setzero_ps(),
+                                           _mm_loadu_ps(s.radius.data() + i));
+        auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& p : planes) {
+            const auto distance =
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0], x), _mm_mul_ps(p[1], y)),
+                           _mm_add_ps(_mm_mul_ps(p[2], z), p[3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, neg_radius));
+        }
+        count += append_lanes(
+            static_cast<uint32_t>(_mm_movemask_ps(inside)), i, out + count);
+    }
+    return count + cull_scalar(f, s, sphere_visible, i, out + count);
+}
+
+inline auto cull_boxes_sse(const frustum& f, const box_set& b, uint32_t* out)
+    -> size_t
+{
+    // normal, distance and absolute normal per plane
+    const auto sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 planes[6][7];
+    for (size_t p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            planes[p][c] = _mm_set1_ps(f.planes[p][c]);
+        }
+        for (int c = 0; c < 3; ++c) {
+            planes[p][4 + c] = _mm_and_ps(planes[p][c], sign_mask);
+        }
+    }
+    size_t count = 0;
+    size_t i     = 0;
+    for (; i + 4 <= b.size(); i += 4) {
+        const auto cx = _mm_loadu_ps(b.center_x.data() + i);
+        const auto cy = _mm_loadu_ps(b.center_y.data() + i);
+        const auto cz = _mm_loadu_ps(b.center_z.data() + i);
+        const auto ex = _mm_loadu_ps(b.extent_x.data() + i);
+        const auto ey = _mm_loadu_ps(b.extent_y.data() + i);
+        const auto ez = _mm_loadu_ps(b.extent_z.data() + i);
+        auto inside   = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& p : planes) {
+            const auto distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(p[0], cx), _mm_mul_ps(p[1], cy)),
+                _mm_add_ps(_mm_mul_ps(p[2], cz), p[3]));
+            const auto reach = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(p[4], ex), _mm_mul_ps(p[5], ey)),
+                _mm_mul_ps(p[6], ez));
+            inside = _mm_and_ps(
+                inside,
+                _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+        }
+        count += append_lanes(
+            static_cast<uint32_t>(_mm_movemask_ps(inside)), i, out + count);
+    }
+    return count + cull_scalar(f, b, box_visible, i, out + count);
+}
+
+// writes 8 indices at out + count every step, count never passes i so
+// that stays within the output of set.size() entries
+ANTARTAR_TARGET_AVX2 inline auto
+append_lanes_avx2(uint32_t mask, size_t base, uint32_t* out)
+{
+    const auto lanes = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(compaction_table[mask].data()));
+    const auto indices =
+        _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(base)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), indices);
+    return static_cast<size_t>(std::popcount(mask));
+}
+
+ANTARTAR_TARGET_AVX2 inline auto
+cull_spheres_avx2(const frustum& f, const sphere_set& s, uint32_t* out)
+    -> size_t
+{
+    __m256 planes[6][4];
+    for (size_t p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            planes[p][c] = _mm256_set1_ps(f.planes[p][c]);
+        }
+    }
+    size_t count = 0;
+    size_t i     = 0;
+    for (; i + 8 <= s.size(); i += 8) {
+        const auto x          = _mm256_loadu_ps(s.x.data() + i);
+        const auto y          = _mm256_loadu_ps(s.y.data() + i);
+        const auto z          = _mm256_loadu_ps(s.z.data() + i);
+        const auto neg_radius = _mm256_sub_ps(
+            _mm256_setzero_ps(), _mm256_loadu_ps(s.radius.data() + i));
+        auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& p : planes) {
+            const auto distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(p[0], x), _mm256_mul_ps(p[1], y)),
+                _mm256_add_ps(_mm256_mul_ps(p[2], z), p[3]));
+            inside = _mm256_and_ps(
+                inside, _mm256_cmp_ps(distance, neg_radius, _CMP_GE_OQ));
+        }
+        count += append_lanes_avx2(
+            static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, out + count);
+    }
+    return count + cull_scalar(f, s, sphere_visible, i, out + count);
+}
+
+ANTARTAR_TARGET_AVX2 inline auto
+cull_boxes_avx2(const frustum& f, const box_set& b, uint32_t* out) -> size_t
+{
+    const auto sign_mask =
+        _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 planes[6][7];
+    for (size_t p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            planes[p][c] = _mm256_set1_ps(f.planes[p][c]);
+        }
+        for (int c = 0; c < 3; ++c) {
+            planes[p][4 + c] = _mm256_and_ps(planes[p][c], sign_mask);
+        }
+    }
+    size_t count = 0;
+    size_t i     = 0;
+    for (; i + 8 <= b.size(); i += 8) {
+        const auto cx = _mm256_loadu_ps(b.center_x.data() + i);
+        const auto cy = _mm256_loadu_ps(b.center_y.data() + i);
+        const auto cz = _mm256_loadu_ps(b.center_z.data() + i);
+        const auto ex = _mm256_loadu_ps(b.extent_x.data() + i);
+        const auto ey = _mm256_loadu_ps(b.extent_y.data() + i);
+        const auto ez = _mm256_loadu_ps(b.extent_z.data() + i);
+        auto inside   = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& p : planes) {
+            const auto distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(p[0], cx), _mm256_mul_ps(p[1], cy)),
+                _mm256_add_ps(_mm256_mul_ps(p[2], cz), p[3]));
+            const auto reach = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(p[4], ex), _mm256_mul_ps(p[5], ey)),
+                _mm256_mul_ps(p[6], ez));
+            inside = _mm256_and_ps(inside,
+                                   _mm256_cmp_ps(_mm256_add_ps(distance, reach),
+                                                 _mm256_setzero_ps(),
+                                                 _CMP_GE_OQ));
+        }
+        count += append_lanes_avx2(
+            static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, out + count);
+    }
+    return count + cull_scalar(f, b, box_visible, i, out + count);
+}
+#endif
+} // namespace detail
+
+// visible gets the ascending indices of the spheres touching the frustum
+inline auto cull(const frustum& f,
+                 const sphere_set& spheres,
+                 std::vector<uint32_t>& visible,
+                 simd_level level = supported_simd_level())
+{
+    visible.resize(spheres.size());
+    size_t count = 0;
+    switch (usable_simd_level(level)) {
+#if ANTARTAR_SIMD_X86
+    case simd_level::avx2:
+        count = detail::cull_spheres_avx2(f, spheres, visible.data());
+        break;
+    case simd_level::sse:
+        count = detail::cull_spheres_sse(f, spheres, visible.data());
+        break;
+#endif
+    default:
+        count = detail::cull_scalar(
+            f, spheres, detail::sphere_visible, 0, visible.data());
+    }
+    visible.resize(count);
+}
+
+// visible gets the ascending indices of the boxes touching the frustum
+inline auto cull(const frustum& f,
+                 const box_set& boxes,
+                 std::vector<uint32_t>& visible,
+                 simd_level level = supported_simd_level())
+{
+    visible.resize(boxes.size());
+    size_t count = 0;
+    switch (usable_simd_level(level)) {
+#if ANTARTAR_SIMD_X86
+    case simd_level::avx2:
+        count = detail::cull_boxes_avx2(f, boxes, visible.data());
+        break;
+    case simd_level::sse:
+        count = detail::cull_boxes_sse(f, boxes, visible.data());
+        break;
+#endif
+    default:
+        count = detail::cull_scalar(
+            f, boxes, detail::box_visible, 0, visible.data());
+    }
+    visible.resize(count);
+}
+} // namespace antartar::culling
@@ -0,0 +1,139 @@
+#pragma once
+#include <antartar/memory.hpp>
+#include <antartar/timeline.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <variant>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// resources frames in flight may still use; retire tags them with the last
+// frame submitted so far and collect destroys them once the frame timeline
+// got there, so nothing is freed behind the gpu's back and nobody waits
+//
+// entries are destroyed in the order they were retired, retire a framebuffer
+// before its views and an image before its memory
+class deletion_queue {
+  public:
+    // non-dispatchable handles are distinct pointer types on 64 bit targets
+    using resource = std::variant<VkBuffer,
+                                  VkImage,
+                                  VkImageView,
+                                  VkSampler,
+                                  VkFramebuffer,
+                                  VkPipeline,
+                                  VkPipelineLayout,
+                                  VkSwapchainKHR,
+                                  memory_allocation>;
+
+  private:
+    struct entry {
+        uint64_t frame;
+        resource object;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::reference_wrapper<memory_allocator> allocator_;
+    std::reference_wrapper<const timeline_semaphore> frames_;
+    // frames never decrease, the front retires first
+    std::deque<entry> entries_;
+
+    static auto is_null_(const memory_allocation& allocation)
+    {
+        return allocation.memory == VK_NULL_HANDLE;
+    }
+
+    static auto is_null_(auto handle) { return handle == VK_NULL_HANDLE; }
+
+    inline auto destroy_(resource& object)
+    {
+        std::visit(
+            [this]<typename T>(T& handle) {
+                if constexpr (std::is_same_v<T, memory_allocation>) {
+                    allocator_.get().free(handle);
+                }
+                else if constexpr (std::is_same_v<T, VkBuffer>) {
+                    vkDestroyBuffer(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkImage>) {
+                    vkDestroyImage(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkImageView>) {
+                    vkDestroyImageView(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkSampler>) {
+                    vkDestroySampler(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkFramebuffer>) {
+                    vkDestroyFramebuffer(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkPipeline>) {
+                    vkDestroyPipeline(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkPipelineLayout>) {
+                    vkDestroyPipelineLayout(device_, handle, nullptr);
+                }
+                else if constexpr (std::is_same_v<T, VkSwapchainKHR>) {
+                    vkDestroySwapchainKHR(device_, handle, nullptr);
+                }
+            },
+            object);
+    }
+
+    inline auto release_(uint64_t completed_frame)
+    {
+        size_t released = 0;
+        while (not entries_.empty()
+               and entries_.front().frame <= completed_frame) {
+            destroy_(entries_.front().object);
+            entries_.pop_front();
+            ++released;
+        }
+        return released;
+    }
+
+  public:
+    inline deletion_queue(VkDevice device,
+                          memory_allocator& allocator,
+                          const timeline_semaphore& frames)
+        : device_{device}, allocator_{allocator}, frames_{frames}
+    {
+    }
+
+    deletion_queue(const deletion_queue&)            = delete;
+    deletion_queue& operator=(const deletion_queue&) = delete;
+
+    // the device has to be idle by now
+    inline ~deletion_queue() { flush(); }
+
+    // null handles are skipped
+    template<typename... Ts> inline auto retire(Ts... objects)
+    {
+        const auto frame = frames_.get().last_reserved();
+        auto push        = [&](resource object) {
+            if (std::visit([](const auto& handle) { return is_null_(handle); },
+                           object)) {
+                return;
+            }
+            entries_.push_back({.frame = frame, .object = object});
+        };
+        (push(objects), ...);
+    }
+
+    // destroys what completed frames left behind, returns how many resources
+    inline auto collect() -> size_t
+    {
+        if (entries_.empty()) {
+            return 0;
+        }
+        return release_(frames_.get().completed());
+    }
+
+    // destroys everything regardless of frames, only once the device is idle
+    inline auto flush() -> size_t { return release_(UINT64_MAX); }
+
+    auto pending() const { return entries_.size(); }
+};
+} // namespace antartar::vk
@@ -0,0 +1,440 @@
+#pragma once
+#include <antartar/deletion.hpp>
+#include <antartar/log.hpp>
+#include <antartar/memory.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// hierarchical z of the previous frame's depth; level 0 is half the depth
+// buffer rounded down and every level halves the one below the same way
+// vulkan sizes mips, every texel of a level holds the farthest depth of the
+// 2x2 texels below it; a level l texel covers 2^(l+1) pixels each way, and
+// whatever lies behind the farthest depth under its footprint is hidden
+//
+// the last texel of an odd axis also takes the row or column the halving
+// leaves over, so lookups clamped to the last texel stay conservative
+//
+// one image shared by all frames in flight, every frame rebuilds it from
+// scratch after the previous one culled against it
+class depth_pyramid {
+  public:
+    static constexpr uint32_t workgroup_size = 8;
+    // enough for a 65536 pixel wide depth buffer
+    static constexpr uint32_t max_levels = 16;
+    static constexpr VkFormat format     = VK_FORMAT_R32_SFLOAT;
+
+  private:
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::reference_wrapper<memory_allocator> allocator_;
+    std::reference_wrapper<deletion_queue> deletions_;
+    VkSampler sampler_                           = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout_            = VK_NULL_HANDLE;
+    VkPipeline pipeline_                         = VK_NULL_HANDLE;
+    VkDescriptorPool descriptor_pool_            = VK_NULL_HANDLE;
+    // max_levels per frame in flight, rewritten when the frame is recorded
+    std::vector<VkDescriptorSet> descriptor_sets_;
+    VkImage image_ = VK_NULL_HANDLE;
+    memory_allocation image_memory_;
+    // all levels, for culling
+    VkImageView view_ = VK_NULL_HANDLE;
+    // one level each, written as storage and read by the next level
+    std::vector<VkImageView> level_views_;
+    VkExtent2D depth_extent_{};
+    VkExtent2D extent_{};
+    uint32_t levels_ = 0;
+    // whether the last build reduced a depth buffer
+    bool valid_ = false;
+
+    inline auto create_sampler_()
+    {
+        VkSamplerCreateInfo sampler_info{
+            .sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter    = VK_FILTER_NEAREST,
+            .minFilter    = VK_FILTER_NEAREST,
+            .mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .maxLod       = VK_LOD_CLAMP_NONE};
+        if (VK_SUCCESS
+            != vkCreateSampler(device_,
+                               std::addressof(sampler_info),
+                               nullptr,
+                               std::addressof(sampler_))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid sampler!"sv));
+        }
+    }
+
+    inline auto create_descriptor_set_layout_()
+    {
+        std::array bindings = {
+            VkDescriptorSetLayoutBinding{
+                .binding         = 0,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = 1,
+                .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT},
+            VkDescriptorSetLayoutBinding{
+                .binding         = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptorCount = 1,
+                .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT},
+        };
+        VkDescriptorSetLayoutCreateInfo layout_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .bindingCount = static_cast<uint32_t>(bindings.size()),
+            .pBindings    = bindings.data()};
+        if (VK_SUCCESS
+            != vkCreateDescriptorSetLayout(
+                device_,
+                std::addressof(layout_info),
+                nullptr,
+                std::addressof(descriptor_set_layout_))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid set layout!"sv));
+        }
+    }
+
+    inline auto create_pipeline_(VkPipelineCache cache, VkShaderModule shader)
+    {
+        VkPipelineLayoutCreateInfo layout_info{
+            .sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .setLayoutCount = 1,
+            .pSetLayouts    = std::addressof(descriptor_set_layout_)};
+        if (VK_SUCCESS
+            != vkCreatePipelineLayout(device_,
+                                      std::addressof(layout_info),
+                                      nullptr,
+                                      std::addressof(pipeline_layout_))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid layout!"sv));
+        }
+        VkComputePipelineCreateInfo pipeline_info{
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .stage = {.sType =
+                          VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                      .stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+                      .module = shader,
+                      .pName  = "main"},
+            .layout = pipeline_layout_};
+        if (VK_SUCCESS
+            != vkCreateComputePipelines(device_,
+                                        cache,
+                                        1,
+                                        std::addressof(pipeline_info),
+                                        nullptr,
+                                        std::addressof(pipeline_))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid pipeline!"sv));
+        }
+    }
+
+    inline auto create_descriptor_sets_(uint32_t frames_in_flight)
+    {
+        const auto set_count = frames_in_flight * max_levels;
+        std::array pool_sizes = {
+            VkDescriptorPoolSize{
+                .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = set_count},
+            VkDescriptorPoolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                 .descriptorCount = set_count},
+        };
+        VkDescriptorPoolCreateInfo pool_info{
+            .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .maxSets       = set_count,
+            .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+            .pPoolSizes    = pool_sizes.data()};
+        if (VK_SUCCESS
+            != vkCreateDescriptorPool(device_,
+                                      std::addressof(pool_info),
+                                      nullptr,
+                                      std::addressof(descriptor_pool_))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid pool!"sv));
+        }
+        std::vector<VkDescriptorSetLayout> layouts(set_count,
+                                                   descriptor_set_layout_);
+        VkDescriptorSetAllocateInfo alloc_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool     = descriptor_pool_,
+            .descriptorSetCount = set_count,
+            .pSetLayouts        = layouts.data()};
+        descriptor_sets_.resize(set_count);
+        if (VK_SUCCESS
+            != vkAllocateDescriptorSets(device_,
+                                        std::addressof(alloc_info),
+                                        descriptor_sets_.data())) {
+            throw std::runtime_error(
+                log_message("failed to allocate depth pyramid sets!"sv));
+        }
+    }
+
+    inline auto create_view_(uint32_t base_level, uint32_t level_count)
+    {
+        VkImageViewCreateInfo view_info{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image            = image_,
+            .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+            .format           = format,
+            .subresourceRange = {.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                                 .baseMipLevel   = base_level,
+                                 .levelCount     = level_count,
+                                 .baseArrayLayer = 0,
+                                 .layerCount     = 1}
+        };
+        VkImageView view = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkCreateImageView(device_,
+                                 std::addressof(view_info),
+                                 nullptr,
+                                 std::addressof(view))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid view!"sv));
+        }
+        return view;
+    }
+
+    inline auto create_image_(VkExtent2D depth_extent)
+    {
+        depth_extent_ = depth_extent;
+        extent_       = {std::max(1u, depth_extent.width / 2),
+                   std::max(1u, depth_extent.height / 2)};
+        levels_ = std::min(
+            max_levels,
+            static_cast<uint32_t>(
+                std::bit_width(std::max(extent_.width, extent_.height))));
+        VkImageCreateInfo image_info{
+            .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType   = VK_IMAGE_TYPE_2D,
+            .format      = format,
+            .extent      = {extent_.width, extent_.height, 1},
+            .mipLevels   = levels_,
+            .arrayLayers = 1,
+            .samples     = VK_SAMPLE_COUNT_1_BIT,
+            .tiling      = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+        if (VK_SUCCESS
+            != vkCreateImage(device_,
+                             std::addressof(image_info),
+                             nullptr,
+                             std::addressof(image_))) {
+            throw std::runtime_error(
+                log_message("failed to create depth pyramid!"sv));
+        }
+        VkMemoryRequirements memory_requirements;
+        vkGetImageMemoryRequirements(device_,
+                                     image_,
+                                     std::addressof(memory_requirements));
+        image_memory_ = allocator_.get().allocate(
+            memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkBindImageMemory(
+            device_, image_, image_memory_.memory, image_memory_.offset);
+        view_ = create_view_(0, levels_);
+        level_views_.resize(levels_);
+        for (uint32_t level = 0; level < levels_; ++level) {
+            level_views_.at(level) = create_view_(level, 1);
+        }
+        valid_ = false;
+    }
+
+    inline auto update_descriptor_set_(VkDescriptorSet set,
+                                       VkImageView source,
+                                       VkImageLayout source_layout,
+                                       VkImageView destination)
+    {
+        VkDescriptorImageInfo source_info{.sampler     = sampler_,
+                                          .imageView   = source,
+                                          .imageLayout = source_layout};
+        VkDescriptorImageInfo destination_info{
+            .imageView   = destination,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+        std::array writes = {
+            VkWriteDescriptorSet{
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = set,
+                .dstBinding      = 0,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo      = std::addressof(source_info)},
+            VkWriteDescriptorSet{
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = set,
+                .dstBinding      = 1,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo      = std::addressof(destination_info)},
+        };
+        vkUpdateDescriptorSets(device_,
+                               static_cast<uint32_t>(writes.size()),
+                               writes.data(),
+                               0,
+                               nullptr);
+    }
+
+    static auto barrier_(VkCommandBuffer command_buffer,
+                         VkAccessFlags src_access,
+                         VkAccessFlags dst_access)
+    {
+        VkMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = src_access,
+                                .dstAccessMask = dst_access};
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1,
+                             std::addressof(barrier),
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
+
+  public:
+    // reduce_shader is depth_pyramid.comp, the caller keeps ownership
+    inline depth_pyramid(VkDevice device,
+                         memory_allocator& allocator,
+                         deletion_queue& deletions,
+                         VkPipelineCache cache,
+                         VkShaderModule reduce_shader,
+                         uint32_t frames_in_flight,
+                         VkExtent2D depth_extent)
+        : device_{device}, allocator_{allocator}, deletions_{deletions}
+    {
+        create_sampler_();
+        create_descriptor_set_layout_();
+        create_pipeline_(cache, reduce_shader);
+        create_descriptor_sets_(frames_in_flight);
+        create_image_(depth_extent);
+    }
+
+    depth_pyramid(const depth_pyramid&)            = delete;
+    depth_pyramid& operator=(const depth_pyramid&) = delete;
+
+    inline ~depth_pyramid()
+    {
+        for (auto view : level_views_) {
+            vkDestroyImageView(device_, view, nullptr);
+        }
+        vkDestroyImageView(device_, view_, nullptr);
+        vkDestroyImage(device_, image_, nullptr);
+        allocator_.get().free(image_memory_);
+        vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+        vkDestroyPipeline(device_, pipeline_, nullptr);
+        vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, descriptor_set_layout_, nullptr);
+        vkDestroySampler(device_, sampler_, nullptr);
+    }
+
+    // follows the depth buffer to its new size, frames in flight keep the
+    // previous image until they retire
+    inline auto resize(VkExtent2D depth_extent)
+    {
+        for (auto view : level_views_) {
+            deletions_.get().retire(view);
+        }
+        deletions_.get().retire(view_, image_, image_memory_);
+        level_views_.clear();
+        create_image_(depth_extent);
+    }
+
+    // outside of a render pass, before the culling pass; depth is the
+    // previous frame's depth buffer in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    // and its writes made visible to compute reads, VK_NULL_HANDLE when there
+    // is none yet and the pyramid is only made ready to be bound
+    inline auto build(VkCommandBuffer command_buffer,
+                      uint32_t frame,
+                      VkImageView depth)
+    {
+        // the previous frame may still cull against the old contents
+        VkImageMemoryBarrier discard{
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image_,
+            .subresourceRange    = {.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    .baseMipLevel   = 0,
+                                    .levelCount     = levels_,
+                                    .baseArrayLayer = 0,
+                                    .layerCount     = 1}
+        };
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             1,
+                             std::addressof(discard));
+        valid_ = depth != VK_NULL_HANDLE;
+        if (not valid_) {
+            return;
+        }
+        vkCmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+        auto width  = extent_.width;
+        auto height = extent_.height;
+        for (uint32_t level = 0; level < levels_; ++level) {
+            auto set = descriptor_sets_.at(frame * max_levels + level);
+            update_descriptor_set_(
+                set,
+                level == 0 ? depth : level_views_.at(level - 1),
+                level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                           : VK_IMAGE_LAYOUT_GENERAL,
+                level_views_.at(level));
+            if (level > 0) {
+                barrier_(command_buffer,
+                         VK_ACCESS_SHADER_WRITE_BIT,
+                         VK_ACCESS_SHADER_READ_BIT);
+            }
+            vkCmdBindDescriptorSets(command_buffer,
+                                    VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    pipeline_layout_,
+                                    0,
+                                    1,
+                                    std::addressof(set),
+                                    0,
+                                    nullptr);
+            vkCmdDispatch(command_buffer,
+                          (width + workgroup_size - 1) / workgroup_size,
+                          (height + workgroup_size - 1) / workgroup_size,
+                          1);
+            // the next mip's size, vulkan rounds down
+            width  = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+        barrier_(command_buffer,
+                 VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    // in VK_IMAGE_LAYOUT_GENERAL once built
+    auto view() const { return view_; }
+
+    auto sampler() const { return sampler_; }
+
+    auto levels() const { return levels_; }
+
+    auto depth_extent() const { return depth_extent_; }
+
+    // false until a depth buffer was reduced, culling against it would be
+    // culling against garbage
+    auto valid() const { return valid_; }
+};
+} // namespace antartar::vk
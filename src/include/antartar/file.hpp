@@ -1,18 +1,36 @@
 #pragma once
 #include <antartar/log.hpp>
+#include <antartar/profiler.hpp>
 #include <filesystem>
 #include <fstream>
+#include <span>
 #include <stdexcept>
 #include <tl/expected.hpp>
 #include <utility>
 #include <vector>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace antartar::file {
-enum [[nodiscard]] status{ok, failed_to_open};
+enum [[nodiscard]] status{ok, failed_to_open, failed_to_write};
 
 inline auto read(const std::filesystem::path& path)
     -> tl::expected<std::pmr::vector<std::byte>, status>
 {
+    ANTARTAR_PROFILE_ZONE("file::read");
     std::ifstream file(path, std::ios::ate | std::ios::binary);
     if (!file.is_open()) {
         return tl::make_unexpected(status::failed_to_open);
@@ -24,6 +42,183 @@ inline auto read(const std::filesystem::path& path)
     return buffer;
 }
 
+// writes next to path first so a crash never leaves a truncated file behind
+inline auto write(const std::filesystem::path& path,
+                  std::span<const std::byte> data) -> status
+{
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return status::failed_to_open;
+        }
+        file.write(reinterpret_cast<const char*>(data.data()),
+                   static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            return status::failed_to_write;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return error ? status::failed_to_write : status::ok;
+}
+
+enum class access_pattern { sequential, random, will_need };
+
+// read-only view of a whole file, memory mapped when the platform allows it
+// and read into an owned buffer otherwise; the span stays valid for the
+// lifetime of the view and is at least 4 byte aligned, enough for spir-v
+class mapped_view {
+  private:
+    const std::byte* data_ = nullptr;
+    size_t size_           = 0;
+    bool mapped_           = false;
+    std::pmr::vector<std::byte> fallback_;
+
+    inline auto release_()
+    {
+        if (not mapped_) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        munmap(const_cast<std::byte*>(data_), size_);
+#endif
+        mapped_ = false;
+    }
+
+    inline mapped_view(const std::byte* data, size_t size)
+        : data_{data}, size_{size}, mapped_{true}
+    {
+    }
+
+    friend inline auto map(const std::filesystem::path&, access_pattern)
+        -> tl::expected<mapped_view, status>;
+
+  public:
+    // owns an already read buffer, used when mapping isn't possible
+    inline explicit mapped_view(std::pmr::vector<std::byte> buffer)
+        : fallback_{std::move(buffer)}
+    {
+        data_ = fallback_.data();
+        size_ = fallback_.size();
+    }
+
+    inline mapped_view(mapped_view&& other) noexcept
+        : data_{std::exchange(other.data_, nullptr)},
+          size_{std::exchange(other.size_, 0)},
+          mapped_{std::exchange(other.mapped_, false)},
+          fallback_{std::move(other.fallback_)}
+    {
+        if (not mapped_) {
+            data_ = fallback_.data();
+        }
+    }
+
+    inline auto operator=(mapped_view&& other) noexcept -> mapped_view&
+    {
+        if (this != std::addressof(other)) {
+            release_();
+            data_     = std::exchange(other.data_, nullptr);
+            size_     = std::exchange(other.size_, 0);
+            mapped_   = std::exchange(other.mapped_, false);
+            fallback_ = std::move(other.fallback_);
+            if (not mapped_) {
+                data_ = fallback_.data();
+            }
+        }
+        return *this;
+    }
+
+    mapped_view(const mapped_view&)            = delete;
+    mapped_view& operator=(const mapped_view&) = delete;
+
+    inline ~mapped_view() { release_(); }
+
+    auto bytes() const { return std::span<const std::byte>{data_, size_}; }
+
+    auto size() const { return size_; }
+
+    auto is_mapped() const { return mapped_; }
+};
+
+// maps path with a paging hint, falls back to read() when mapping fails
+inline auto map(const std::filesystem::path& path,
+                access_pattern pattern = access_pattern::sequential)
+    -> tl::expected<mapped_view, status>
+{
+    ANTARTAR_PROFILE_ZONE("file::map");
+    auto fallback = [&]() -> tl::expected<mapped_view, status> {
+        return read(path).map(
+            [](auto&& buffer) { return mapped_view{std::move(buffer)}; });
+    };
+#ifdef _WIN32
+    const DWORD flags = pattern == access_pattern::random
+                            ? FILE_FLAG_RANDOM_ACCESS
+                            : FILE_FLAG_SEQUENTIAL_SCAN;
+    HANDLE file       = CreateFileW(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | flags,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return tl::make_unexpected(status::failed_to_open);
+    }
+    LARGE_INTEGER file_size{};
+    if (not GetFileSizeEx(file, std::addressof(file_size))
+        or file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return fallback();
+    }
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    // the view keeps the mapping and the file alive on its own
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return fallback();
+    }
+    auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr) {
+        return fallback();
+    }
+    const auto size = static_cast<size_t>(file_size.QuadPart);
+    if (pattern == access_pattern::will_need) {
+        WIN32_MEMORY_RANGE_ENTRY range{.VirtualAddress = data,
+                                       .NumberOfBytes  = size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+    return mapped_view{static_cast<const std::byte*>(data), size};
+#else
+    const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return tl::make_unexpected(status::failed_to_open);
+    }
+    struct stat info {};
+    if (fstat(fd, std::addressof(info)) != 0 or info.st_size == 0) {
+        close(fd);
+        return fallback();
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    auto data       = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping holds its own reference to the file
+    close(fd);
+    if (data == MAP_FAILED) {
+        return fallback();
+    }
+    const auto advice = pattern == access_pattern::random ? MADV_RANDOM
+                        : pattern == access_pattern::will_need
+                            ? MADV_WILLNEED
+                            : MADV_SEQUENTIAL;
+    madvise(data, size, advice);
+    return mapped_view{static_cast<const std::byte*>(data), size};
+#endif
+}
+
 namespace path {
 constexpr inline auto join(auto... args)
 {
@@ -0,0 +1,1245 @@
+#pragma once
+#include <antartar/culling.hpp>
+#include <antartar/log.hpp>
+#include <antartar/memory.hpp>
+#include <antartar/mesh.hpp>
+#include <antartar/ocean.hpp>
+#include <antartar/quadtree.hpp>
+#include <antartar/staging.hpp>
+#include <antartar/vertex_format.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numbers>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// the surface of ocean::simulation computed on the device: the initial
+// spectrum is uploaded once, then every frame a compute pass advances it,
+// transforms it with row and column ffts and writes displacement and
+// normals into images the ocean's vertex shader samples; only the drawn
+// quadtree nodes cross the bus per frame
+//
+// one set of images shared by all frames in flight, a frame's compute waits
+// for the previous frame's vertex shader, like the depth pyramid
+//
+// the surface is drawn as a quadtree around the eye, every node an instance
+// of one of two shared grids, so the vertex count stays put however far the
+// ocean reaches; distant nodes sample the surface's mips
+class gpu_ocean {
+  public:
+    static constexpr uint32_t workgroup_size = 8;
+    // instances per frame, selections past it lose their farthest nodes
+    static constexpr uint32_t max_nodes = 4096;
+    // ffts in place, choppy displacement and slope in one, height in the
+    // other
+    static constexpr VkFormat field_format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    static constexpr VkFormat surface_format =
+        VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // ocean_spectrum.comp, ocean_fft.comp, ocean_surface.comp, ocean.vert
+    // and ocean.frag, the caller keeps ownership
+    struct shaders {
+        VkShaderModule spectrum = VK_NULL_HANDLE;
+        VkShaderModule fft      = VK_NULL_HANDLE;
+        VkShaderModule surface  = VK_NULL_HANDLE;
+        VkShaderModule vertex   = VK_NULL_HANDLE;
+        VkShaderModule fragment = VK_NULL_HANDLE;
+    };
+
+    // one frame's surface copied back, texel by texel row by row with rows
+    // along z
+    struct capture {
+        // seconds into the simulation
+        double time = 0.;
+        // offsets from the grid position in x and z, the height in y
+        std::vector<glm::vec4> displacement;
+        // the normal in xyz, the jacobian of the horizontal displacement in w
+        std::vector<glm::vec4> normals;
+    };
+
+  private:
+    // the layout of every compute shader's push constants
+    struct push_constants {
+        // time as a fraction of the repeat period
+        float cycle;
+        float patch_length;
+        float choppiness;
+        uint32_t vertical;
+    };
+
+    // a node grid vertex in node units, exact for grids of up to 1024 quads
+    struct grid_vertex {
+        static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        half2 position;
+
+        static auto members() { return std::tuple{&grid_vertex::position}; }
+    };
+
+    struct node_instance {
+        static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        quadtree::node node;
+
+        static auto members() { return std::tuple{&node_instance::node}; }
+    };
+
+    // the layout of ocean.vert's push constants
+    struct camera {
+        glm::mat4 view_projection;
+        glm::vec3 eye;
+        float patch_length;
+        float size;
+        // what the vertex shader needs of the quadtree to morph
+        float grid;
+        float leaf_size;
+        float first_range;
+        float morph_start;
+    };
+    static_assert(sizeof(camera) == 100);
+
+    // fields of the transforms, then the surface
+    enum image : uint32_t { fields_xz, fields_y, displacement, normals };
+    static constexpr uint32_t image_count = 4;
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::reference_wrapper<memory_allocator> allocator_;
+    ocean::parameters parameters_;
+    VkSampler sampler_                        = VK_NULL_HANDLE;
+    VkDescriptorSetLayout compute_set_layout_ = VK_NULL_HANDLE;
+    VkDescriptorSetLayout surface_set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout compute_layout_          = VK_NULL_HANDLE;
+    VkPipelineLayout surface_layout_          = VK_NULL_HANDLE;
+    VkPipeline spectrum_pipeline_             = VK_NULL_HANDLE;
+    VkPipeline fft_pipeline_                  = VK_NULL_HANDLE;
+    VkPipeline surface_pipeline_              = VK_NULL_HANDLE;
+    VkPipeline graphics_pipeline_             = VK_NULL_HANDLE;
+    VkDescriptorPool descriptor_pool_         = VK_NULL_HANDLE;
+    VkDescriptorSet compute_set_              = VK_NULL_HANDLE;
+    VkDescriptorSet surface_set_              = VK_NULL_HANDLE;
+    std::array<VkImage, image_count> images_{};
+    std::array<memory_allocation, image_count> image_memory_{};
+    // level 0 of every image for the compute passes
+    std::array<VkImageView, image_count> views_{};
+    // displacement and normals with all their mips for the vertex shader
+    std::array<VkImageView, 2> sampled_views_{};
+    uint32_t mip_levels_ = 1;
+    // h0 and its mirror per wave as vec4, then cycles per repeat period
+    VkBuffer initial_ = VK_NULL_HANDLE;
+    memory_allocation initial_memory_;
+    VkBuffer cycles_ = VK_NULL_HANDLE;
+    memory_allocation cycles_memory_;
+    // the full node grid, then the quarter node grid of half as many quads
+    // a side, vertices in node units
+    VkBuffer grid_vertices_ = VK_NULL_HANDLE;
+    memory_allocation grid_vertices_memory_;
+    VkBuffer grid_indices_ = VK_NULL_HANDLE;
+    memory_allocation grid_indices_memory_;
+    uint32_t full_index_count_     = 0;
+    uint32_t quarter_index_count_  = 0;
+    int32_t quarter_vertex_offset_ = 0;
+    // max_nodes per frame in flight, host visible
+    VkBuffer instances_ = VK_NULL_HANDLE;
+    memory_allocation instance_memory_;
+    uint32_t frames_in_flight_ = 1;
+    quadtree::settings lod_;
+    quadtree::selection selection_;
+    culling::box_set bounds_;
+    std::vector<uint32_t> visible_;
+    // how far the waves move a vertex off its rest position, up and down,
+    // then sideways
+    float wave_height_         = 0.f;
+    float wave_reach_          = 0.f;
+    uint32_t drawn_vertices_   = 0;
+    bool warned_node_overflow_ = false;
+    // host visible, created on the first request_capture
+    VkBuffer capture_buffer_ = VK_NULL_HANDLE;
+    memory_allocation capture_memory_;
+    bool capture_requested_ = false;
+    std::optional<double> capture_time_;
+
+    auto size_() const { return parameters_.size; }
+
+    auto texel_count_() const { return size_t{size_()} * size_(); }
+
+    // rgba16f
+    auto surface_bytes_() const -> VkDeviceSize
+    {
+        return texel_count_() * 4 * sizeof(uint16_t);
+    }
+
+    // the ffts keep a whole line per workgroup in shared memory
+    inline auto check_limits_(const VkPhysicalDeviceLimits& limits) const
+    {
+        const auto half   = size_() / 2;
+        const auto shared = size_() * (sizeof(glm::vec4) + sizeof(glm::vec2));
+        if (half > limits.maxComputeWorkGroupSize[0]
+            or half > limits.maxComputeWorkGroupInvocations
+            or shared > limits.maxComputeSharedMemorySize) {
+            throw std::runtime_error(log_message(fmt::format(
+                "gpu ocean of size {} needs {} invocations and {} bytes of "
+                "shared memory per workgroup, the device has {} and {}",
+                size_(),
+                half,
+                shared,
+                std::min(limits.maxComputeWorkGroupSize[0],
+                         limits.maxComputeWorkGroupInvocations),
+                limits.maxComputeSharedMemorySize)));
+        }
+    }
+
+    // a full chain where rgba16f can be blitted and filtered, the far
+    // nodes alias without it
+    inline auto choose_mip_levels_(VkPhysicalDevice physical_device)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(
+            physical_device, surface_format, std::addressof(properties));
+        const VkFormatFeatureFlags needed =
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+            | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        mip_levels_ = (properties.optimalTilingFeatures & needed) == needed
+                          ? static_cast<uint32_t>(std::bit_width(size_()))
+                          : 1;
+    }
+
+    inline auto create_buffer_(VkDeviceSize size,
+                               VkBufferUsageFlags usage,
+                               VkMemoryPropertyFlags properties,
+                               VkBuffer& buffer,
+                               memory_allocation& memory)
+    {
+        VkBufferCreateInfo buffer_info{
+            .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size        = size,
+            .usage       = usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+        if (VK_SUCCESS
+            != vkCreateBuffer(device_,
+                              std::addressof(buffer_info),
+                              nullptr,
+                              std::addressof(buffer))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean buffer!"sv));
+        }
+        VkMemoryRequirements memory_requirements;
+        vkGetBufferMemoryRequirements(device_,
+                                      buffer,
+                                      std::addressof(memory_requirements));
+        memory = allocator_.get().allocate(memory_requirements, properties);
+        vkBindBufferMemory(device_, buffer, memory.memory, memory.offset);
+    }
+
+    inline auto create_view_(VkImage image,
+                             VkFormat format,
+                             uint32_t levels,
+                             VkImageView& view)
+    {
+        VkImageViewCreateInfo view_info{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image            = image,
+            .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+            .format           = format,
+            .subresourceRange = {.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                                 .baseMipLevel   = 0,
+                                 .levelCount     = levels,
+                                 .baseArrayLayer = 0,
+                                 .layerCount     = 1}
+        };
+        if (VK_SUCCESS
+            != vkCreateImageView(device_,
+                                 std::addressof(view_info),
+                                 nullptr,
+                                 std::addressof(view))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean view!"sv));
+        }
+    }
+
+    inline auto create_image_(image index, VkFormat format)
+    {
+        const auto surface = index == displacement or index == normals;
+        const auto usage   = surface ? VK_IMAGE_USAGE_STORAGE_BIT
+                                         | VK_IMAGE_USAGE_SAMPLED_BIT
+                                         | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                                         | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                                   : VK_IMAGE_USAGE_STORAGE_BIT;
+        VkImageCreateInfo image_info{
+            .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType     = VK_IMAGE_TYPE_2D,
+            .format        = format,
+            .extent        = {size_(), size_(), 1},
+            .mipLevels     = surface ? mip_levels_ : 1,
+            .arrayLayers   = 1,
+            .samples       = VK_SAMPLE_COUNT_1_BIT,
+            .tiling        = VK_IMAGE_TILING_OPTIMAL,
+            .usage         = static_cast<VkImageUsageFlags>(usage),
+            .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+        auto& target = images_.at(index);
+        if (VK_SUCCESS
+            != vkCreateImage(device_,
+                             std::addressof(image_info),
+                             nullptr,
+                             std::addressof(target))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean image!"sv));
+        }
+        VkMemoryRequirements memory_requirements;
+        vkGetImageMemoryRequirements(device_,
+                                     target,
+                                     std::addressof(memory_requirements));
+        auto& memory = image_memory_.at(index);
+        memory       = allocator_.get().allocate(
+            memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkBindImageMemory(device_, target, memory.memory, memory.offset);
+        create_view_(target, format, 1, views_.at(index));
+        if (surface) {
+            create_view_(target,
+                         format,
+                         mip_levels_,
+                         sampled_views_.at(index - displacement));
+        }
+    }
+
+    inline auto create_sampler_()
+    {
+        VkSamplerCreateInfo sampler_info{
+            .sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter    = VK_FILTER_LINEAR,
+            .minFilter    = VK_FILTER_LINEAR,
+            .mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            .maxLod       = VK_LOD_CLAMP_NONE};
+        if (VK_SUCCESS
+            != vkCreateSampler(device_,
+                               std::addressof(sampler_info),
+                               nullptr,
+                               std::addressof(sampler_))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean sampler!"sv));
+        }
+    }
+
+    inline auto create_set_layout_(
+        std::span<const VkDescriptorSetLayoutBinding> bindings)
+    {
+        VkDescriptorSetLayoutCreateInfo layout_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .bindingCount = static_cast<uint32_t>(bindings.size()),
+            .pBindings    = bindings.data()};
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkCreateDescriptorSetLayout(device_,
+                                           std::addressof(layout_info),
+                                           nullptr,
+                                           std::addressof(layout))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean set layout!"sv));
+        }
+        return layout;
+    }
+
+    inline auto create_set_layouts_()
+    {
+        // initial spectrum and cycles, then the four images
+        std::array<VkDescriptorSetLayoutBinding, 2 + image_count> compute{};
+        for (uint32_t i = 0; i < compute.size(); ++i) {
+            compute.at(i) = {
+                .binding         = i,
+                .descriptorType  = i < 2 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                         : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptorCount = 1,
+                .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT};
+        }
+        compute_set_layout_ = create_set_layout_(compute);
+        // displacement and normals
+        std::array<VkDescriptorSetLayoutBinding, 2> surface{};
+        for (uint32_t i = 0; i < surface.size(); ++i) {
+            surface.at(i) = {
+                .binding         = i,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = 1,
+                .stageFlags      = VK_SHADER_STAGE_VERTEX_BIT};
+        }
+        surface_set_layout_ = create_set_layout_(surface);
+    }
+
+    inline auto create_pipeline_layout_(VkDescriptorSetLayout set_layout,
+                                        VkPushConstantRange push_constants)
+    {
+        VkPipelineLayoutCreateInfo layout_info{
+            .sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .setLayoutCount = 1,
+            .pSetLayouts    = std::addressof(set_layout),
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges    = std::addressof(push_constants)};
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkCreatePipelineLayout(device_,
+                                      std::addressof(layout_info),
+                                      nullptr,
+                                      std::addressof(layout))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean layout!"sv));
+        }
+        return layout;
+    }
+
+    inline auto
+    create_compute_pipeline_(VkPipelineCache cache,
+                             VkShaderModule shader,
+                             const VkSpecializationInfo* specialization)
+    {
+        VkComputePipelineCreateInfo pipeline_info{
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .stage = {.sType =
+                          VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                      .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+                      .module              = shader,
+                      .pName               = "main",
+                      .pSpecializationInfo = specialization},
+            .layout = compute_layout_};
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkCreateComputePipelines(device_,
+                                        cache,
+                                        1,
+                                        std::addressof(pipeline_info),
+                                        nullptr,
+                                        std::addressof(pipeline))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean pipeline!"sv));
+        }
+        return pipeline;
+    }
+
+    inline auto create_compute_pipelines_(VkPipelineCache cache,
+                                          const shaders& modules)
+    {
+        compute_layout_ = create_pipeline_layout_(
+            compute_set_layout_,
+            {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+             .offset     = 0,
+             .size       = sizeof(push_constants)});
+        spectrum_pipeline_ =
+            create_compute_pipeline_(cache, modules.spectrum, nullptr);
+        surface_pipeline_ =
+            create_compute_pipeline_(cache, modules.surface, nullptr);
+        // the line length and a workgroup of one butterfly per pair
+        const std::array<uint32_t, 2> constants = {size_(), size_() / 2};
+        const std::array entries = {
+            VkSpecializationMapEntry{.constantID = 0,
+                                     .offset     = 0,
+                                     .size       = sizeof(uint32_t)},
+            VkSpecializationMapEntry{.constantID = 1,
+                                     .offset     = sizeof(uint32_t),
+                                     .size       = sizeof(uint32_t)},
+        };
+        VkSpecializationInfo specialization{
+            .mapEntryCount = static_cast<uint32_t>(entries.size()),
+            .pMapEntries   = entries.data(),
+            .dataSize      = sizeof(constants),
+            .pData         = constants.data()};
+        fft_pipeline_ = create_compute_pipeline_(
+            cache, modules.fft, std::addressof(specialization));
+    }
+
+    inline auto create_graphics_pipeline_(VkPipelineCache cache,
+                                          VkRenderPass render_pass,
+                                          const shaders& modules)
+    {
+        surface_layout_ = create_pipeline_layout_(
+            surface_set_layout_,
+            {.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+             .offset     = 0,
+             .size       = sizeof(camera)});
+        std::array stages = {
+            VkPipelineShaderStageCreateInfo{
+                .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage  = VK_SHADER_STAGE_VERTEX_BIT,
+                .module = modules.vertex,
+                .pName  = "main"},
+            VkPipelineShaderStageCreateInfo{
+                .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage  = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module = modules.fragment,
+                .pName  = "main"},
+        };
+        const auto bindings =
+            vertex_input_bindings<grid_vertex, node_instance>();
+        const auto attributes =
+            vertex_input_attributes<grid_vertex, node_instance>();
+        VkPipelineVertexInputStateCreateInfo vertex_input{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .vertexBindingDescriptionCount =
+                static_cast<uint32_t>(bindings.size()),
+            .pVertexBindingDescriptions = bindings.data(),
+            .vertexAttributeDescriptionCount =
+                static_cast<uint32_t>(attributes.size()),
+            .pVertexAttributeDescriptions = attributes.data()};
+        VkPipelineInputAssemblyStateCreateInfo input_assembly{
+            .sType =
+                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+        VkPipelineViewportStateCreateInfo viewport_state{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+            .viewportCount = 1,
+            .scissorCount  = 1};
+        // waves are seen from both sides when they fold over
+        VkPipelineRasterizationStateCreateInfo rasterizer{
+            .sType =
+                VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+            .polygonMode = VK_POLYGON_MODE_FILL,
+            .cullMode    = VK_CULL_MODE_NONE,
+            .frontFace   = VK_FRONT_FACE_CLOCKWISE,
+            .lineWidth   = 1.f};
+        VkPipelineMultisampleStateCreateInfo multisampling{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+            .minSampleShading     = 1.f};
+        VkPipelineColorBlendAttachmentState color_blend_attachment{
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT
+                              | VK_COLOR_COMPONENT_G_BIT
+                              | VK_COLOR_COMPONENT_B_BIT
+                              | VK_COLOR_COMPONENT_A_BIT};
+        VkPipelineColorBlendStateCreateInfo color_blending{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+            .attachmentCount = 1,
+            .pAttachments    = std::addressof(color_blend_attachment)};
+        VkPipelineDepthStencilStateCreateInfo depth_stencil{
+            .sType =
+                VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .depthTestEnable  = VK_TRUE,
+            .depthWriteEnable = VK_TRUE,
+            .depthCompareOp   = VK_COMPARE_OP_LESS,
+            .minDepthBounds   = 0.f,
+            .maxDepthBounds   = 1.f};
+        std::array dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT,
+                                     VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamic_state{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+            .dynamicStateCount = static_cast<uint32_t>(dynamic_states.size()),
+            .pDynamicStates    = dynamic_states.data()};
+        VkGraphicsPipelineCreateInfo pipeline_info{
+            .sType      = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .stageCount = static_cast<uint32_t>(stages.size()),
+            .pStages    = stages.data(),
+            .pVertexInputState   = std::addressof(vertex_input),
+            .pInputAssemblyState = std::addressof(input_assembly),
+            .pViewportState      = std::addressof(viewport_state),
+            .pRasterizationState = std::addressof(rasterizer),
+            .pMultisampleState   = std::addressof(multisampling),
+            .pDepthStencilState  = std::addressof(depth_stencil),
+            .pColorBlendState    = std::addressof(color_blending),
+            .pDynamicState       = std::addressof(dynamic_state),
+            .layout              = surface_layout_,
+            .renderPass          = render_pass,
+            .subpass             = 0,
+            .basePipelineIndex   = -1};
+        if (VK_SUCCESS
+            != vkCreateGraphicsPipelines(device_,
+                                         cache,
+                                         1,
+                                         std::addressof(pipeline_info),
+                                         nullptr,
+                                         std::addressof(graphics_pipeline_))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean surface pipeline!"sv));
+        }
+    }
+
+    inline auto create_descriptor_sets_()
+    {
+        std::array pool_sizes = {
+            VkDescriptorPoolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                 .descriptorCount = 2},
+            VkDescriptorPoolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                 .descriptorCount = image_count},
+            VkDescriptorPoolSize{
+                .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = 2},
+        };
+        VkDescriptorPoolCreateInfo pool_info{
+            .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .maxSets       = 2,
+            .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+            .pPoolSizes    = pool_sizes.data()};
+        if (VK_SUCCESS
+            != vkCreateDescriptorPool(device_,
+                                      std::addressof(pool_info),
+                                      nullptr,
+                                      std::addressof(descriptor_pool_))) {
+            throw std::runtime_error(
+                log_message("failed to create gpu ocean pool!"sv));
+        }
+        std::array layouts = {compute_set_layout_, surface_set_layout_};
+        std::array<VkDescriptorSet, 2> sets{};
+        VkDescriptorSetAllocateInfo alloc_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool     = descriptor_pool_,
+            .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+            .pSetLayouts        = layouts.data()};
+        if (VK_SUCCESS
+            != vkAllocateDescriptorSets(
+                device_, std::addressof(alloc_info), sets.data())) {
+            throw std::runtime_error(
+                log_message("failed to allocate gpu ocean sets!"sv));
+        }
+        compute_set_ = sets.at(0);
+        surface_set_ = sets.at(1);
+    }
+
+    // the sets never change, the images and buffers live as long as they do
+    inline auto write_descriptor_sets_()
+    {
+        std::array buffers = {
+            VkDescriptorBufferInfo{.buffer = initial_, .range = VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo{.buffer = cycles_, .range = VK_WHOLE_SIZE},
+        };
+        std::array<VkDescriptorImageInfo, image_count> storage{};
+        for (uint32_t i = 0; i < image_count; ++i) {
+            storage.at(i) = {.imageView   = views_.at(i),
+                             .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+        }
+        std::array sampled = {
+            VkDescriptorImageInfo{.sampler     = sampler_,
+                                  .imageView   = sampled_views_.at(0),
+                                  .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+            VkDescriptorImageInfo{.sampler     = sampler_,
+                                  .imageView   = sampled_views_.at(1),
+                                  .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+        };
+        std::array writes = {
+            VkWriteDescriptorSet{
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = compute_set_,
+                .dstBinding      = 0,
+                .descriptorCount = static_cast<uint32_t>(buffers.size()),
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo     = buffers.data()},
+            VkWriteDescriptorSet{
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = compute_set_,
+                .dstBinding      = 2,
+                .descriptorCount = static_cast<uint32_t>(storage.size()),
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo      = storage.data()},
+            VkWriteDescriptorSet{
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = surface_set_,
+                .dstBinding      = 0,
+                .descriptorCount = static_cast<uint32_t>(sampled.size()),
+                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo      = sampled.data()},
+        };
+        vkUpdateDescriptorSets(device_,
+                               static_cast<uint32_t>(writes.size()),
+                               writes.data(),
+                               0,
+                               nullptr);
+    }
+
+    // the standard deviation of the height is the root of the spectrum's
+    // energy, and the horizontal displacement's spectrum has the same
+    // magnitudes; crests beyond four of them are rare enough to pop in
+    inline auto measure_waves_(const ocean::initial_spectrum& initial)
+    {
+        auto energy = 0.;
+        for (const auto& h : initial.h0) {
+            energy += glm::dot(h, h);
+        }
+        wave_height_ = 4.f * static_cast<float>(std::sqrt(energy));
+        wave_reach_  = wave_height_ * std::max(parameters_.choppiness, 0.f);
+    }
+
+    // quads on a side, vertices from 0 to 1 appended to vertices, indices
+    // relative to the grid's first vertex; rows of quads reuse nothing
+    // across rows wider than the cache, so the grid goes through the mesh
+    // optimizer first
+    static auto append_grid_(uint32_t quads,
+                             std::vector<grid_vertex>& vertices,
+                             std::vector<uint32_t>& indices)
+    {
+        const auto step = 1.f / static_cast<float>(quads);
+        std::vector<glm::vec2> grid;
+        grid.reserve(size_t{quads + 1} * (quads + 1));
+        for (uint32_t z = 0; z <= quads; ++z) {
+            for (uint32_t x = 0; x <= quads; ++x) {
+                grid.emplace_back(static_cast<float>(x) * step,
+                                  static_cast<float>(z) * step);
+            }
+        }
+        std::vector<uint32_t> grid_indices;
+        grid_indices.reserve(size_t{quads} * quads * 6);
+        for (uint32_t z = 0; z < quads; ++z) {
+            for (uint32_t x = 0; x < quads; ++x) {
+                const auto corner = z * (quads + 1) + x;
+                const auto below  = corner + quads + 1;
+                grid_indices.insert(std::end(grid_indices),
+                                    {corner, below, corner + 1,
+                                     corner + 1, below, below + 1});
+            }
+        }
+        mesh::optimize(grid_indices, grid, [](glm::vec2 v) {
+            return glm::vec3{v.x, 0.f, v.y};
+        });
+        for (const auto v : grid) {
+            vertices.push_back({v});
+        }
+        indices.insert(std::end(indices),
+                       std::begin(grid_indices),
+                       std::end(grid_indices));
+    }
+
+    // the initial spectrum, the node grids and the instance slots, once
+    inline auto upload_(staging_ring& staging)
+    {
+        const auto initial    = ocean::draw_spectrum(parameters_);
+        const auto omega_step = 2.f * std::numbers::pi_v<float>
+                                / parameters_.repeat_period;
+        // whole cycles per period, the shader takes the fraction of their
+        // product with the time before it becomes an angle
+        std::vector<float> cycles(initial.omega.size());
+        for (size_t i = 0; i < cycles.size(); ++i) {
+            cycles[i] = std::round(initial.omega[i] / omega_step);
+        }
+        const auto storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                             | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        create_buffer_(std::span{initial.h0}.size_bytes(),
+                       storage,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       initial_,
+                       initial_memory_);
+        create_buffer_(std::span{cycles}.size_bytes(),
+                       storage,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       cycles_,
+                       cycles_memory_);
+        staging.upload(initial_, 0, std::as_bytes(std::span{initial.h0}));
+        staging.upload(cycles_, 0, std::as_bytes(std::span{cycles}));
+        measure_waves_(initial);
+
+        std::vector<grid_vertex> vertices;
+        std::vector<uint32_t> indices;
+        append_grid_(lod_.grid, vertices, indices);
+        full_index_count_      = static_cast<uint32_t>(indices.size());
+        quarter_vertex_offset_ = static_cast<int32_t>(vertices.size());
+        append_grid_(lod_.grid / 2, vertices, indices);
+        quarter_index_count_ =
+            static_cast<uint32_t>(indices.size()) - full_index_count_;
+        create_buffer_(std::span{vertices}.size_bytes(),
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+                           | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       grid_vertices_,
+                       grid_vertices_memory_);
+        create_buffer_(std::span{indices}.size_bytes(),
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+                           | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       grid_indices_,
+                       grid_indices_memory_);
+        staging.upload(grid_vertices_, 0, std::as_bytes(std::span{vertices}));
+        staging.upload(grid_indices_, 0, std::as_bytes(std::span{indices}));
+        create_buffer_(VkDeviceSize{frames_in_flight_} * max_nodes
+                           * sizeof(node_instance),
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                           | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       instances_,
+                       instance_memory_);
+    }
+
+    static auto barrier_(VkCommandBuffer command_buffer,
+                         VkPipelineStageFlags src_stages,
+                         VkAccessFlags src_access,
+                         VkPipelineStageFlags dst_stages,
+                         VkAccessFlags dst_access)
+    {
+        VkMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = src_access,
+                                .dstAccessMask = dst_access};
+        vkCmdPipelineBarrier(command_buffer,
+                             src_stages,
+                             dst_stages,
+                             0,
+                             1,
+                             std::addressof(barrier),
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
+
+    // each level of displacement and normals filtered down from the one
+    // above, all of it in the general layout the compute passes left
+    inline auto record_mips_(VkCommandBuffer command_buffer)
+    {
+        for (uint32_t level = 1; level < mip_levels_; ++level) {
+            barrier_(command_buffer,
+                     level == 1 ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                : VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     level == 1 ? VK_ACCESS_SHADER_WRITE_BIT
+                                : VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_READ_BIT);
+            const auto src = static_cast<int32_t>(size_() >> (level - 1));
+            const auto dst = std::max(src / 2, 1);
+            VkImageBlit blit{
+                .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                   .mipLevel   = level - 1,
+                                   .layerCount = 1},
+                .srcOffsets     = {{0, 0, 0}, {src, src, 1}},
+                .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                   .mipLevel   = level,
+                                   .layerCount = 1},
+                .dstOffsets     = {{0, 0, 0}, {dst, dst, 1}}
+            };
+            for (const auto index : {displacement, normals}) {
+                vkCmdBlitImage(command_buffer,
+                               images_.at(index),
+                               VK_IMAGE_LAYOUT_GENERAL,
+                               images_.at(index),
+                               VK_IMAGE_LAYOUT_GENERAL,
+                               1,
+                               std::addressof(blit),
+                               VK_FILTER_LINEAR);
+            }
+        }
+    }
+
+    // the nodes' boxes grown by how far the waves move their vertices
+    inline auto cull_nodes_(const glm::mat4& view_projection)
+    {
+        bounds_.clear();
+        for (const auto* nodes : {std::addressof(selection_.full),
+                                  std::addressof(selection_.quarters)}) {
+            for (const auto& n : *nodes) {
+                bounds_.push(
+                    {n.x - wave_reach_, -wave_height_, n.y - wave_reach_},
+                    {n.x + n.z + wave_reach_,
+                     wave_height_,
+                     n.y + n.z + wave_reach_});
+            }
+        }
+        culling::cull(
+            culling::extract_frustum(view_projection), bounds_, visible_);
+    }
+
+    // keeps the max_nodes visible nodes nearest to eye in the xz plane, in
+    // ascending index order again
+    inline auto keep_nearest_nodes_(glm::vec3 eye)
+    {
+        const auto distance = [&](uint32_t index) {
+            const auto& n = index < selection_.full.size()
+                                ? selection_.full[index]
+                                : selection_.quarters[index
+                                                      - selection_.full.size()];
+            const auto dx = std::max({n.x - eye.x, 0.f, eye.x - n.x - n.z});
+            const auto dz = std::max({n.y - eye.z, 0.f, eye.z - n.y - n.z});
+            return dx * dx + dz * dz;
+        };
+        const auto kept = std::begin(visible_) + max_nodes;
+        std::ranges::nth_element(visible_, kept, {}, distance);
+        visible_.erase(kept, std::end(visible_));
+        std::ranges::sort(visible_);
+    }
+
+    inline auto record_capture_(VkCommandBuffer command_buffer)
+    {
+        for (auto [i, index] : {std::pair{0u, displacement},
+                               std::pair{1u, normals}}) {
+            VkBufferImageCopy region{
+                .bufferOffset     = i * surface_bytes_(),
+                .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                     .layerCount = 1},
+                .imageExtent      = {size_(), size_(), 1}
+            };
+            vkCmdCopyImageToBuffer(command_buffer,
+                                   images_.at(index),
+                                   VK_IMAGE_LAYOUT_GENERAL,
+                                   capture_buffer_,
+                                   1,
+                                   std::addressof(region));
+        }
+        VkBufferMemoryBarrier copied{
+            .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer              = capture_buffer_,
+            .size                = VK_WHOLE_SIZE};
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_HOST_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             std::addressof(copied),
+                             0,
+                             nullptr);
+    }
+
+  public:
+    // throws when the device can't run ffts of parameters.size; the
+    // spectrum and grid uploads go through staging and are ordered before
+    // the next frame
+    inline gpu_ocean(VkDevice device,
+                     VkPhysicalDevice physical_device,
+                     memory_allocator& allocator,
+                     staging_ring& staging,
+                     VkPipelineCache cache,
+                     VkRenderPass render_pass,
+                     const shaders& modules,
+                     uint32_t frames_in_flight,
+                     const ocean::parameters& parameters)
+        : device_{device},
+          allocator_{allocator},
+          parameters_{parameters},
+          frames_in_flight_{frames_in_flight}
+    {
+        ocean::validate(parameters_);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device,
+                                      std::addressof(properties));
+        check_limits_(properties.limits);
+        choose_mip_levels_(physical_device);
+        // a quad per texel at level 0 and as many levels as mips, which
+        // puts the horizon 160 patches out whatever the size
+        lod_.leaf_size = static_cast<float>(lod_.grid)
+                         * parameters_.patch_length
+                         / static_cast<float>(size_());
+        lod_.levels = static_cast<uint32_t>(std::bit_width(size_())) + 1;
+        for (const auto index : {fields_xz, fields_y}) {
+            create_image_(index, field_format);
+        }
+        for (const auto index : {displacement, normals}) {
+            create_image_(index, surface_format);
+        }
+        create_sampler_();
+        create_set_layouts_();
+        create_compute_pipelines_(cache, modules);
+        create_graphics_pipeline_(cache, render_pass, modules);
+        create_descriptor_sets_();
+        upload_(staging);
+        write_descriptor_sets_();
+    }
+
+    gpu_ocean(const gpu_ocean&)            = delete;
+    gpu_ocean& operator=(const gpu_ocean&) = delete;
+
+    // the device has to be idle by now
+    inline ~gpu_ocean()
+    {
+        for (auto [buffer, memory] :
+             {std::pair{capture_buffer_, capture_memory_},
+              std::pair{instances_, instance_memory_},
+              std::pair{grid_indices_, grid_indices_memory_},
+              std::pair{grid_vertices_, grid_vertices_memory_},
+              std::pair{cycles_, cycles_memory_},
+              std::pair{initial_, initial_memory_}}) {
+            if (buffer != VK_NULL_HANDLE) {
+                vkDestroyBuffer(device_, buffer, nullptr);
+                allocator_.get().free(memory);
+            }
+        }
+        for (auto view : sampled_views_) {
+            vkDestroyImageView(device_, view, nullptr);
+        }
+        for (uint32_t i = 0; i < image_count; ++i) {
+            vkDestroyImageView(device_, views_.at(i), nullptr);
+            vkDestroyImage(device_, images_.at(i), nullptr);
+            allocator_.get().free(image_memory_.at(i));
+        }
+        vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+        for (auto pipeline : {graphics_pipeline_,
+                              surface_pipeline_,
+                              fft_pipeline_,
+                              spectrum_pipeline_}) {
+            vkDestroyPipeline(device_, pipeline, nullptr);
+        }
+        vkDestroyPipelineLayout(device_, surface_layout_, nullptr);
+        vkDestroyPipelineLayout(device_, compute_layout_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, surface_set_layout_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, compute_set_layout_, nullptr);
+        vkDestroySampler(device_, sampler_, nullptr);
+    }
+
+    // outside of a render pass, before draw; the surface time seconds in
+    inline auto record(VkCommandBuffer command_buffer, double time)
+    {
+        // everything is rewritten, the previous frame only has to be done
+        // reading
+        std::array<VkImageMemoryBarrier, image_count> discard{};
+        for (uint32_t i = 0; i < image_count; ++i) {
+            discard.at(i) = {
+                .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask       = 0,
+                .dstAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+                .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image               = images_.at(i),
+                .subresourceRange    = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                        .levelCount = VK_REMAINING_MIP_LEVELS,
+                                        .layerCount = 1}};
+        }
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+                                 | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             static_cast<uint32_t>(discard.size()),
+                             discard.data());
+
+        push_constants constants{
+            .cycle = static_cast<float>(ocean::looped_time(time, parameters_)
+                                        / parameters_.repeat_period),
+            .patch_length = parameters_.patch_length,
+            .choppiness   = parameters_.choppiness,
+            .vertical     = 0};
+        auto push = [&] {
+            vkCmdPushConstants(command_buffer,
+                               compute_layout_,
+                               VK_SHADER_STAGE_COMPUTE_BIT,
+                               0,
+                               sizeof(constants),
+                               std::addressof(constants));
+        };
+        const auto n      = size_();
+        const auto groups = (n + workgroup_size - 1) / workgroup_size;
+        const auto fields = VK_ACCESS_SHADER_READ_BIT
+                            | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                compute_layout_,
+                                0,
+                                1,
+                                std::addressof(compute_set_),
+                                0,
+                                nullptr);
+        push();
+        vkCmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, spectrum_pipeline_);
+        vkCmdDispatch(command_buffer, groups, groups, 1);
+        barrier_(command_buffer,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                 fields);
+
+        // every row, then every column, a workgroup per line
+        vkCmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, fft_pipeline_);
+        for (const uint32_t vertical : {0u, 1u}) {
+            constants.vertical = vertical;
+            push();
+            vkCmdDispatch(command_buffer, n, 1, 1);
+            barrier_(command_buffer,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     fields);
+        }
+
+        vkCmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, surface_pipeline_);
+        vkCmdDispatch(command_buffer, groups, groups, 1);
+        record_mips_(command_buffer);
+        barrier_(command_buffer,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                     | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                 VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+                     | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                 VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+        if (capture_requested_) {
+            record_capture_(command_buffer);
+            capture_requested_ = false;
+            capture_time_      = time;
+        }
+    }
+
+    // inside the render pass, after record; selects and culls the nodes
+    // around eye and writes them to frame's instance slots
+    inline auto draw(VkCommandBuffer command_buffer,
+                     uint32_t frame,
+                     VkExtent2D extent,
+                     const glm::mat4& view_projection,
+                     glm::vec3 eye)
+    {
+        quadtree::select(lod_, eye, selection_);
+        cull_nodes_(view_projection);
+        if (visible_.size() > max_nodes) {
+            if (not warned_node_overflow_) {
+                log<severity::warning>(
+                    "gpu ocean selected {} visible nodes, drawing the {} "
+                    "nearest",
+                    visible_.size(),
+                    max_nodes);
+                warned_node_overflow_ = true;
+            }
+            keep_nearest_nodes_(eye);
+        }
+        // visible is ascending, the full nodes come first
+        auto* instances = static_cast<node_instance*>(instance_memory_.mapped)
+                          + size_t{frame} * max_nodes;
+        uint32_t full_count = 0;
+        for (uint32_t i = 0; i < visible_.size(); ++i) {
+            const auto index = visible_[i];
+            if (index < selection_.full.size()) {
+                instances[i] = {selection_.full[index]};
+                ++full_count;
+            }
+            else {
+                instances[i] = {
+                    selection_.quarters[index - selection_.full.size()]};
+            }
+        }
+        const auto quarter_count =
+            static_cast<uint32_t>(visible_.size()) - full_count;
+        const auto grid = size_t{lod_.grid};
+        drawn_vertices_ = static_cast<uint32_t>(
+            full_count * (grid + 1) * (grid + 1)
+            + quarter_count * (grid / 2 + 1) * (grid / 2 + 1));
+
+        vkCmdBindPipeline(command_buffer,
+                          VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          graphics_pipeline_);
+        VkViewport viewport{.x        = 0.f,
+                            .y        = 0.f,
+                            .width    = static_cast<float>(extent.width),
+                            .height   = static_cast<float>(extent.height),
+                            .minDepth = 0.f,
+                            .maxDepth = 1.f};
+        vkCmdSetViewport(command_buffer, 0, 1, std::addressof(viewport));
+        VkRect2D scissor{.offset = {0, 0}, .extent = extent};
+        vkCmdSetScissor(command_buffer, 0, 1, std::addressof(scissor));
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                surface_layout_,
+                                0,
+                                1,
+                                std::addressof(surface_set_),
+                                0,
+                                nullptr);
+        const camera constants{
+            .view_projection = view_projection,
+            .eye             = eye,
+            .patch_length    = parameters_.patch_length,
+            .size            = static_cast<float>(size_()),
+            .grid            = static_cast<float>(lod_.grid),
+            .leaf_size       = lod_.leaf_size,
+            .first_range     = quadtree::range(lod_, 0),
+            .morph_start     = lod_.morph_start};
+        vkCmdPushConstants(command_buffer,
+                           surface_layout_,
+                           VK_SHADER_STAGE_VERTEX_BIT,
+                           0,
+                           sizeof(constants),
+                           std::addressof(constants));
+        const std::array buffers = {grid_vertices_, instances_};
+        const std::array<VkDeviceSize, 2> offsets = {
+            0, VkDeviceSize{frame} * max_nodes * sizeof(node_instance)};
+        vkCmdBindVertexBuffers(
+            command_buffer, 0, 2, buffers.data(), offsets.data());
+        vkCmdBindIndexBuffer(
+            command_buffer, grid_indices_, 0, VK_INDEX_TYPE_UINT32);
+        if (full_count > 0) {
+            vkCmdDrawIndexed(
+                command_buffer, full_index_count_, full_count, 0, 0, 0);
+        }
+        if (quarter_count > 0) {
+            vkCmdDrawIndexed(command_buffer,
+                             quarter_index_count_,
+                             quarter_count,
+                             full_index_count_,
+                             quarter_vertex_offset_,
+                             full_count);
+        }
+    }
+
+    // the next recorded frame copies its surface back for captured()
+    inline auto request_capture()
+    {
+        if (capture_buffer_ == VK_NULL_HANDLE) {
+            create_buffer_(2 * surface_bytes_(),
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                               | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           capture_buffer_,
+                           capture_memory_);
+        }
+        capture_requested_ = true;
+        capture_time_.reset();
+    }
+
+    // the surface of the frame that took the capture, once the frame
+    // completed; nothing until a requested capture was recorded
+    inline auto captured() const -> std::optional<capture>
+    {
+        if (not capture_time_) {
+            return std::nullopt;
+        }
+        const auto count = texel_count_();
+        std::vector<uint16_t> halves(4 * count);
+        capture result{.time         = *capture_time_,
+                       .displacement = std::vector<glm::vec4>(count),
+                       .normals      = std::vector<glm::vec4>(count)};
+        for (auto [i, target] :
+             {std::pair{0u, std::addressof(result.displacement)},
+              std::pair{1u, std::addressof(result.normals)}}) {
+            std::memcpy(halves.data(),
+                        static_cast<const std::byte*>(capture_memory_.mapped)
+                            + i * surface_bytes_(),
+                        surface_bytes_());
+            for (size_t t = 0; t < count; ++t) {
+                (*target)[t] = {half_to_float(halves[4 * t]),
+                                half_to_float(halves[4 * t + 1]),
+                                half_to_float(halves[4 * t + 2]),
+                                half_to_float(halves[4 * t + 3])};
+            }
+        }
+        return result;
+    }
+
+    auto size() const { return size_(); }
+
+    auto patch_length() const { return parameters_.patch_length; }
+
+    // how far from the eye the farthest node's far corner can be
+    auto horizon() const
+    {
+        const auto top = lod_.levels - 1;
+        return quadtree::range(lod_, top)
+               + std::numbers::sqrt2_v<float> * quadtree::node_size(lod_, top);
+    }
+
+    // vertices of the nodes the last draw submitted
+    auto drawn_vertices() const { return drawn_vertices_; }
+
+    auto parameters() const -> const ocean::parameters&
+    {
+        return parameters_;
+    }
+};
+} // namespace antartar::vk
@@ -0,0 +1,174 @@
+#pragma once
+#include <antartar/log.hpp>
+#include <array>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+struct timestamp_properties {
+    // nanoseconds per tick
+    float period        = 1.f;
+    uint64_t valid_mask = ~0ull;
+
+    inline auto to_milliseconds(uint64_t begin, uint64_t end) const
+    {
+        return static_cast<double>((end - begin) & valid_mask) * period / 1e6;
+    }
+};
+
+// nullopt when queues of the family can't write timestamps
+inline auto query_timestamp_properties(VkPhysicalDevice physical_device,
+                                       uint32_t queue_family)
+    -> std::optional<timestamp_properties>
+{
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device,
+                                             std::addressof(family_count),
+                                             nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device,
+                                             std::addressof(family_count),
+                                             families.data());
+    const auto valid_bits = families.at(queue_family).timestampValidBits;
+    if (valid_bits == 0) {
+        return std::nullopt;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, std::addressof(properties));
+    return timestamp_properties{
+        .period     = properties.limits.timestampPeriod,
+        .valid_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1};
+}
+
+// timestamp query pool per frame in flight; a slot is read back when it's
+// about to be reused, after its frame's timeline value was waited on, so
+// collecting results never stalls and they lag frames_in_flight frames behind
+class gpu_profiler {
+  public:
+    static constexpr uint32_t max_zones = 16;
+
+    struct zone_result {
+        std::string_view name;
+        double milliseconds;
+    };
+
+  private:
+    struct frame_slot {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::array<std::string_view, max_zones> names{};
+        uint32_t zone_count = 0;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    timestamp_properties timestamps_;
+    std::vector<frame_slot> slots_;
+    frame_slot* current_ = nullptr;
+    std::vector<zone_result> results_;
+    std::array<uint64_t, 2 * max_zones> ticks_{};
+
+    inline auto collect_(frame_slot& slot)
+    {
+        if (slot.zone_count == 0) {
+            return;
+        }
+        // no VK_QUERY_RESULT_WAIT_BIT, the timeline wait already guarantees
+        // the results, VK_NOT_READY just drops the frame
+        const auto result = vkGetQueryPoolResults(device_,
+                                                  slot.pool,
+                                                  0,
+                                                  2 * slot.zone_count,
+                                                  sizeof(ticks_),
+                                                  ticks_.data(),
+                                                  sizeof(uint64_t),
+                                                  VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            return;
+        }
+        results_.clear();
+        for (uint32_t zone = 0; zone < slot.zone_count; ++zone) {
+            results_.push_back(
+                {.name         = slot.names.at(zone),
+                 .milliseconds = timestamps_.to_milliseconds(
+                     ticks_.at(2 * zone), ticks_.at(2 * zone + 1))});
+        }
+    }
+
+  public:
+    inline gpu_profiler(VkDevice device,
+                        timestamp_properties timestamps,
+                        uint32_t frames_in_flight)
+        : device_{device}, timestamps_{timestamps}, slots_(frames_in_flight)
+    {
+        VkQueryPoolCreateInfo pool_info{
+            .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2 * max_zones};
+        for (auto& slot : slots_) {
+            if (VK_SUCCESS
+                != vkCreateQueryPool(device_,
+                                     std::addressof(pool_info),
+                                     nullptr,
+                                     std::addressof(slot.pool))) {
+                throw std::runtime_error(
+                    log_message("failed to create timestamp query pool!"sv));
+            }
+        }
+        results_.reserve(max_zones);
+    }
+
+    gpu_profiler(const gpu_profiler&)            = delete;
+    gpu_profiler& operator=(const gpu_profiler&) = delete;
+
+    inline ~gpu_profiler()
+    {
+        for (auto& slot : slots_) {
+            vkDestroyQueryPool(device_, slot.pool, nullptr);
+        }
+    }
+
+    // must be recorded outside of a render pass, before any zone
+    inline auto begin_frame(VkCommandBuffer command_buffer, uint32_t frame)
+    {
+        current_ = std::addressof(slots_.at(frame));
+        collect_(*current_);
+        current_->zone_count = 0;
+        vkCmdResetQueryPool(command_buffer, current_->pool, 0, 2 * max_zones);
+    }
+
+    // name has to outlive the profiler, zones past max_zones aren't timed
+    inline auto begin_zone(VkCommandBuffer command_buffer,
+                           std::string_view name,
+                           VkPipelineStageFlagBits stage =
+                               VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT)
+        -> std::optional<uint32_t>
+    {
+        if (current_->zone_count == max_zones) {
+            return std::nullopt;
+        }
+        const auto zone          = current_->zone_count++;
+        current_->names.at(zone) = name;
+        vkCmdWriteTimestamp(command_buffer, stage, current_->pool, 2 * zone);
+        return zone;
+    }
+
+    inline auto end_zone(VkCommandBuffer command_buffer,
+                         std::optional<uint32_t> zone,
+                         VkPipelineStageFlagBits stage =
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+    {
+        if (zone) {
+            vkCmdWriteTimestamp(command_buffer,
+                                stage,
+                                current_->pool,
+                                2 * *zone + 1);
+        }
+    }
+
+    // zones of the most recent frame whose results were collected
+    auto results() const { return std::span<const zone_result>{results_}; }
+};
+} // namespace antartar::vk
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <antartar/log.hpp>
+#include <antartar/vk.hpp>
+#include <cstdint>
+#include <span>
+
+namespace antartar {
+// stands in for scoped_glfw3_window when there is no display, the renderer
+// draws into offscreen images instead of a swap chain
+class headless_window {
+  private:
+    VkExtent2D extent_;
+    bool readback_;
+    uint64_t frames_presented_ = 0;
+    uint64_t last_frame_hash_  = 0;
+
+    // fnv-1a, only has to be stable between runs on the same icd
+    static inline auto hash_(std::span<const std::byte> pixels)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (auto b : pixels) {
+            hash = (hash ^ static_cast<uint64_t>(b)) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+  public:
+    inline headless_window(uint32_t width, uint32_t height, bool readback)
+        : extent_{.width = width, .height = height}, readback_{readback}
+    {
+    }
+
+    auto extent() const { return extent_; }
+
+    auto readback() const { return readback_; }
+
+    // called with tightly packed rgba8 pixels of every rendered frame when
+    // readback is enabled
+    inline auto present(std::span<const std::byte> pixels)
+    {
+        last_frame_hash_ = hash_(pixels);
+        ++frames_presented_;
+    }
+
+    auto frames_presented() const { return frames_presented_; }
+
+    auto last_frame_hash() const { return last_frame_hash_; }
+};
+
+class headless {
+  private:
+    headless_window window_;
+    vk::vk<headless_window> vulkan_;
+
+  public:
+    inline headless(uint32_t width,
+                    uint32_t height,
+                    bool readback,
+                    const vk::frame_pacing& pacing = {})
+        : window_(width, height, readback), vulkan_(window_, pacing)
+    {
+    }
+
+    auto draw_frame() { vulkan_.draw_frame(); }
+
+    auto wait_idle() { vulkan_.wait_idle(); }
+
+    auto startup() const { return vulkan_.startup(); }
+
+    auto last_frame_timings() const { return vulkan_.last_frame_timings(); }
+
+    auto pacing() const { return vulkan_.pacing(); }
+
+    auto present_mode() const { return vulkan_.present_mode(); }
+
+    auto gpu_frame_timings() const { return vulkan_.gpu_frame_timings(); }
+
+    auto set_instances(std::span<const vk::instance> instances, bool instanced)
+    {
+        vulkan_.set_instances(instances, instanced);
+    }
+
+    auto draw_calls() const { return vulkan_.draw_calls(); }
+
+    auto set_indirect(bool enabled) { vulkan_.set_indirect(enabled); }
+
+    auto draw_path() const { return vulkan_.draw_path(); }
+
+    auto set_occlusion(bool enabled) { vulkan_.set_occlusion(enabled); }
+
+    auto culls_occluded() const { return vulkan_.culls_occluded(); }
+
+    auto simulate_ocean(const ocean::parameters& parameters)
+    {
+        vulkan_.simulate_ocean(parameters);
+    }
+
+    auto simulate_gpu_ocean(const ocean::parameters& parameters)
+    {
+        vulkan_.simulate_gpu_ocean(parameters);
+    }
+
+    auto capture_gpu_ocean() { vulkan_.capture_gpu_ocean(); }
+
+    auto gpu_ocean_capture() const { return vulkan_.gpu_ocean_capture(); }
+
+    auto gpu_ocean_parameters() const -> const ocean::parameters&
+    {
+        return vulkan_.gpu_ocean_parameters();
+    }
+
+    auto gpu_ocean_vertices() const { return vulkan_.gpu_ocean_vertices(); }
+
+    auto take_gpu_upload_milliseconds()
+    {
+        return vulkan_.take_gpu_upload_milliseconds();
+    }
+
+    const auto& target() const { return window_; }
+};
+} // namespace antartar
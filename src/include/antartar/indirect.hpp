@@ -0,0 +1,421 @@
+#pragma once
+#include <antartar/deletion.hpp>
+#include <antartar/depth_pyramid.hpp>
+#include <antartar/log.hpp>
+#include <antartar/memory.hpp>
+#include <antartar/staging.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// one draw of the list as the gpu sees it, laid out like the std430 struct
+// of draw_commands.comp
+struct indirect_draw {
+    VkDrawIndexedIndirectCommand command;
+    // nearest depth of the draw, for occlusion culling
+    float depth = 0.f;
+    std::array<uint32_t, 2> padding{};
+    // min xy, max xy in normalized device coordinates
+    glm::vec4 bounds;
+};
+static_assert(sizeof(indirect_draw) == 48);
+
+// gpu copy of the draw list; every frame a compute pass writes the commands
+// of visible draws for vkCmdDrawIndexedIndirect(Count), so recording costs
+// the same for one draw or a hundred thousand
+//
+// visible is inside the viewport and, with occlusion culling, not behind the
+// depth pyramid of the previous frame; draws that only came into view this
+// frame show up one frame late
+//
+// with a count buffer visible commands are compacted to the front, without
+// one culled commands stay in place with no instances
+class indirect_draws {
+  public:
+    static constexpr uint32_t workgroup_size = 64;
+
+  private:
+    struct push_constants {
+        uint32_t draw_count;
+        uint32_t compact;
+        uint32_t occlusion;
+        uint32_t pyramid_levels;
+        glm::vec2 viewport_size;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::reference_wrapper<memory_allocator> allocator_;
+    std::reference_wrapper<deletion_queue> deletions_;
+    bool count_buffer_                            = false;
+    VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout_            = VK_NULL_HANDLE;
+    VkPipeline pipeline_                         = VK_NULL_HANDLE;
+    VkDescriptorPool descriptor_pool_            = VK_NULL_HANDLE;
+    // per frame in flight, rewritten when the frame is recorded
+    std::vector<VkDescriptorSet> descriptor_sets_;
+    VkBuffer draws_ = VK_NULL_HANDLE;
+    memory_allocation draws_memory_;
+    VkBuffer commands_ = VK_NULL_HANDLE;
+    memory_allocation commands_memory_;
+    VkBuffer count_ = VK_NULL_HANDLE;
+    memory_allocation count_memory_;
+    uint32_t draw_count_ = 0;
+
+    inline auto create_buffer_(VkDeviceSize size,
+                               VkBufferUsageFlags usage,
+                               VkBuffer& buffer,
+                               memory_allocation& memory)
+    {
+        VkBufferCreateInfo buffer_info{
+            .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size        = size,
+            .usage       = usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+        if (VK_SUCCESS
+            != vkCreateBuffer(device_,
+                              std::addressof(buffer_info),
+                              nullptr,
+                              std::addressof(buffer))) {
+            throw std::runtime_error(
+                log_message("failed to create indirect draw buffer!"sv));
+        }
+        VkMemoryRequirements memory_requirements;
+        vkGetBufferMemoryRequirements(device_,
+                                      buffer,
+                                      std::addressof(memory_requirements));
+        memory = allocator_.get().allocate(memory_requirements,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkBindBufferMemory(device_, buffer, memory.memory, memory.offset);
+    }
+
+    inline auto create_descriptor_set_layout_()
+    {
+        // draws, commands, count and the depth pyramid
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+        for (uint32_t i = 0; i < bindings.size(); ++i) {
+            bindings.at(i) = {
+                .binding         = i,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT};
+        }
+        bindings.back().descriptorType =
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        VkDescriptorSetLayoutCreateInfo layout_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .bindingCount = static_cast<uint32_t>(bindings.size()),
+            .pBindings    = bindings.data()};
+        if (VK_SUCCESS
+            != vkCreateDescriptorSetLayout(
+                device_,
+                std::addressof(layout_info),
+                nullptr,
+                std::addressof(descriptor_set_layout_))) {
+            throw std::runtime_error(
+                log_message("failed to create draw commands set layout!"sv));
+        }
+    }
+
+    inline auto create_pipeline_(VkPipelineCache cache, VkShaderModule shader)
+    {
+        VkPushConstantRange push_constant_range{
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset     = 0,
+            .size       = sizeof(push_constants)};
+        VkPipelineLayoutCreateInfo layout_info{
+            .sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .setLayoutCount = 1,
+            .pSetLayouts    = std::addressof(descriptor_set_layout_),
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges    = std::addressof(push_constant_range)};
+        if (VK_SUCCESS
+            != vkCreatePipelineLayout(device_,
+                                      std::addressof(layout_info),
+                                      nullptr,
+                                      std::addressof(pipeline_layout_))) {
+            throw std::runtime_error(
+                log_message("failed to create draw commands layout!"sv));
+        }
+        VkComputePipelineCreateInfo pipeline_info{
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .stage = {.sType =
+                          VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                      .stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+                      .module = shader,
+                      .pName  = "main"},
+            .layout = pipeline_layout_};
+        if (VK_SUCCESS
+            != vkCreateComputePipelines(device_,
+                                        cache,
+                                        1,
+                                        std::addressof(pipeline_info),
+                                        nullptr,
+                                        std::addressof(pipeline_))) {
+            throw std::runtime_error(
+                log_message("failed to create draw commands pipeline!"sv));
+        }
+    }
+
+    inline auto create_descriptor_sets_(uint32_t frames_in_flight)
+    {
+        std::array pool_sizes = {
+            VkDescriptorPoolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                 .descriptorCount = 3 * frames_in_flight},
+            VkDescriptorPoolSize{
+                .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = frames_in_flight},
+        };
+        VkDescriptorPoolCreateInfo pool_info{
+            .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .maxSets       = frames_in_flight,
+            .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+            .pPoolSizes    = pool_sizes.data()};
+        if (VK_SUCCESS
+            != vkCreateDescriptorPool(device_,
+                                      std::addressof(pool_info),
+                                      nullptr,
+                                      std::addressof(descriptor_pool_))) {
+            throw std::runtime_error(
+                log_message("failed to create draw commands pool!"sv));
+        }
+        std::vector<VkDescriptorSetLayout> layouts(frames_in_flight,
+                                                   descriptor_set_layout_);
+        VkDescriptorSetAllocateInfo alloc_info{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool     = descriptor_pool_,
+            .descriptorSetCount = frames_in_flight,
+            .pSetLayouts        = layouts.data()};
+        descriptor_sets_.resize(frames_in_flight);
+        if (VK_SUCCESS
+            != vkAllocateDescriptorSets(device_,
+                                        std::addressof(alloc_info),
+                                        descriptor_sets_.data())) {
+            throw std::runtime_error(
+                log_message("failed to allocate draw commands sets!"sv));
+        }
+    }
+
+    inline auto update_descriptor_set_(VkDescriptorSet set,
+                                       const depth_pyramid& pyramid)
+    {
+        std::array buffer_infos = {
+            VkDescriptorBufferInfo{draws_,    0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo{commands_, 0, VK_WHOLE_SIZE},
+            VkDescriptorBufferInfo{count_,    0, VK_WHOLE_SIZE},
+        };
+        VkDescriptorImageInfo pyramid_info{
+            .sampler     = pyramid.sampler(),
+            .imageView   = pyramid.view(),
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        for (uint32_t i = 0; i < buffer_infos.size(); ++i) {
+            writes.at(i) = {
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = set,
+                .dstBinding      = i,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo     = std::addressof(buffer_infos.at(i))};
+        }
+        writes.back() = {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = set,
+            .dstBinding      = 3,
+            .descriptorCount = 1,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo      = std::addressof(pyramid_info)};
+        vkUpdateDescriptorSets(device_,
+                               static_cast<uint32_t>(writes.size()),
+                               writes.data(),
+                               0,
+                               nullptr);
+    }
+
+    static auto barrier_(VkCommandBuffer command_buffer,
+                         VkPipelineStageFlags src_stages,
+                         VkAccessFlags src_access,
+                         VkPipelineStageFlags dst_stages,
+                         VkAccessFlags dst_access)
+    {
+        VkMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = src_access,
+                                .dstAccessMask = dst_access};
+        vkCmdPipelineBarrier(command_buffer,
+                             src_stages,
+                             dst_stages,
+                             0,
+                             1,
+                             std::addressof(barrier),
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
+
+  public:
+    // build_shader is draw_commands.comp, the caller keeps ownership
+    inline indirect_draws(VkDevice device,
+                          memory_allocator& allocator,
+                          deletion_queue& deletions,
+                          VkPipelineCache cache,
+                          VkShaderModule build_shader,
+                          uint32_t frames_in_flight,
+                          bool count_buffer)
+        : device_{device},
+          allocator_{allocator},
+          deletions_{deletions},
+          count_buffer_{count_buffer}
+    {
+        create_descriptor_set_layout_();
+        create_pipeline_(cache, build_shader);
+        create_descriptor_sets_(frames_in_flight);
+        create_buffer_(sizeof(uint32_t),
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                           | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                           | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       count_,
+                       count_memory_);
+    }
+
+    indirect_draws(const indirect_draws&)            = delete;
+    indirect_draws& operator=(const indirect_draws&) = delete;
+
+    inline ~indirect_draws()
+    {
+        vkDestroyBuffer(device_, draws_, nullptr);
+        allocator_.get().free(draws_memory_);
+        vkDestroyBuffer(device_, commands_, nullptr);
+        allocator_.get().free(commands_memory_);
+        vkDestroyBuffer(device_, count_, nullptr);
+        allocator_.get().free(count_memory_);
+        vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+        vkDestroyPipeline(device_, pipeline_, nullptr);
+        vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, descriptor_set_layout_, nullptr);
+    }
+
+    // replaces the draw list, frames in flight keep the previous buffers
+    // until they retire; the copy is ordered before the next frame by the
+    // staging ring
+    inline auto upload(staging_ring& staging,
+                       std::span<const indirect_draw> draws)
+    {
+        deletions_.get().retire(
+            draws_, draws_memory_, commands_, commands_memory_);
+        draw_count_ = static_cast<uint32_t>(draws.size());
+        if (draws.empty()) {
+            draws_    = VK_NULL_HANDLE;
+            commands_ = VK_NULL_HANDLE;
+            return;
+        }
+        create_buffer_(draws.size_bytes(),
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                           | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       draws_,
+                       draws_memory_);
+        create_buffer_(draws.size() * sizeof(VkDrawIndexedIndirectCommand),
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                           | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                       commands_,
+                       commands_memory_);
+        staging.upload(draws_, 0, std::as_bytes(draws));
+    }
+
+    // outside of a render pass, after the pyramid was built and before draw;
+    // the frame's descriptor set must not be in use anymore, occlusion is
+    // skipped while the pyramid holds no depth yet
+    inline auto build(VkCommandBuffer command_buffer,
+                      uint32_t frame,
+                      const depth_pyramid& pyramid,
+                      bool occlusion)
+    {
+        if (draw_count_ == 0) {
+            return;
+        }
+        auto set = descriptor_sets_.at(frame);
+        update_descriptor_set_(set, pyramid);
+        // the previous frame may still read the commands and the count
+        barrier_(command_buffer,
+                 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                 0,
+                 VK_PIPELINE_STAGE_TRANSFER_BIT
+                     | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                 0);
+        if (count_buffer_) {
+            vkCmdFillBuffer(command_buffer, count_, 0, sizeof(uint32_t), 0);
+            barrier_(command_buffer,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        }
+        vkCmdBindPipeline(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                pipeline_layout_,
+                                0,
+                                1,
+                                std::addressof(set),
+                                0,
+                                nullptr);
+        const auto viewport = pyramid.depth_extent();
+        push_constants constants{
+            .draw_count     = draw_count_,
+            .compact        = count_buffer_ ? 1u : 0u,
+            .occlusion      = occlusion and pyramid.valid() ? 1u : 0u,
+            .pyramid_levels = pyramid.levels(),
+            .viewport_size  = {static_cast<float>(viewport.width),
+                               static_cast<float>(viewport.height)}};
+        vkCmdPushConstants(command_buffer,
+                           pipeline_layout_,
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           0,
+                           sizeof(constants),
+                           std::addressof(constants));
+        vkCmdDispatch(command_buffer,
+                      (draw_count_ + workgroup_size - 1) / workgroup_size,
+                      1,
+                      1);
+        barrier_(command_buffer,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                 VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    }
+
+    // inside the render pass with the draw state bound
+    inline auto draw(VkCommandBuffer command_buffer) const
+    {
+        if (draw_count_ == 0) {
+            return;
+        }
+        if (count_buffer_) {
+            vkCmdDrawIndexedIndirectCount(command_buffer,
+                                          commands_,
+                                          0,
+                                          count_,
+                                          0,
+                                          draw_count_,
+                                          sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else {
+            vkCmdDrawIndexedIndirect(command_buffer,
+                                     commands_,
+                                     0,
+                                     draw_count_,
+                                     sizeof(VkDrawIndexedIndirectCommand));
+        }
+    }
+
+    auto count_buffer() const { return count_buffer_; }
+
+    auto draw_count() const { return draw_count_; }
+};
+} // namespace antartar::vk
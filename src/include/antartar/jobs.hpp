@@ -0,0 +1,456 @@
+#pragma once
+#include <antartar/log.hpp>
+#include <antartar/profiler.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace antartar::jobs {
+// completion of a group of jobs, the first exception thrown by any of them is
+// kept and rethrown by scheduler::wait
+class counter {
+  private:
+    std::atomic<uint32_t> pending_{0};
+    std::atomic_flag failed_;
+    std::exception_ptr error_;
+
+  public:
+    inline explicit counter(uint32_t pending = 0) : pending_{pending} {}
+
+    counter(const counter&)            = delete;
+    counter& operator=(const counter&) = delete;
+
+    auto add(uint32_t count)
+    {
+        pending_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    auto done() { pending_.fetch_sub(1, std::memory_order_acq_rel); }
+
+    auto is_done() const
+    {
+        return pending_.load(std::memory_order_acquire) == 0;
+    }
+
+    inline auto fail(std::exception_ptr error)
+    {
+        if (not failed_.test_and_set(std::memory_order_acq_rel)) {
+            error_ = std::move(error);
+        }
+    }
+
+    auto failed() const { return failed_.test(std::memory_order_acquire); }
+
+    // only once is_done
+    inline auto rethrow() const
+    {
+        if (failed()) {
+            std::rethrow_exception(error_);
+        }
+    }
+};
+
+// owned by whoever submits it and must outlive its execution; done is
+// signaled last, after that the job is not touched by the scheduler anymore
+struct job {
+    void (*invoke)(job&) = nullptr;
+    void* context        = nullptr;
+    size_t first         = 0;
+    size_t last          = 0;
+    counter* done        = nullptr;
+};
+
+// chase-lev deque: the owning worker pushes and pops at the bottom, thieves
+// steal from the top; fixed capacity, a full deque makes push fail and the
+// caller run the job inline
+class work_deque {
+  public:
+    static constexpr int64_t capacity = 1 << 12;
+
+  private:
+    std::unique_ptr<std::atomic<job*>[]> slots_{
+        new std::atomic<job*>[capacity]};
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+
+    auto slot_(int64_t index) -> std::atomic<job*>&
+    {
+        return slots_[index & (capacity - 1)];
+    }
+
+  public:
+    inline auto push(job* j) -> bool
+    {
+        const auto bottom = bottom_.load(std::memory_order_relaxed);
+        const auto top    = top_.load(std::memory_order_acquire);
+        if (bottom - top >= capacity) {
+            return false;
+        }
+        slot_(bottom).store(j, std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline auto pop() -> job*
+    {
+        const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto j = slot_(bottom).load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // last one, race the thieves for it
+            if (not top_.compare_exchange_strong(top,
+                                                 top + 1,
+                                                 std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+                j = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return j;
+    }
+
+    inline auto steal() -> job*
+    {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        auto j = slot_(top).load(std::memory_order_relaxed);
+        if (not top_.compare_exchange_strong(top,
+                                             top + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return j;
+    }
+};
+
+// the thread constructing the scheduler is worker 0 and runs jobs while it
+// waits, the others are background threads sleeping when there's no work;
+// jobs are submitted and waited for from worker threads only, i.e. the
+// owning thread or from inside other jobs
+class scheduler {
+  private:
+    struct alignas(64) worker {
+        work_deque deque;
+        std::minstd_rand victims;
+    };
+
+    // zero initialized like every thread_local, set by background threads
+    struct thread_slot {
+        scheduler* owner;
+        uint32_t index;
+    };
+
+    static inline thread_local thread_slot current_;
+
+    std::thread::id owner_thread_ = std::this_thread::get_id();
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> sleeping_{0};
+    std::atomic<bool> stopping_{false};
+    // declared last, threads must stop before the state above goes away
+    std::vector<std::jthread> threads_;
+
+    auto local_index_() const -> std::optional<uint32_t>
+    {
+        if (current_.owner == this) {
+            return current_.index;
+        }
+        if (std::this_thread::get_id() == owner_thread_) {
+            return 0;
+        }
+        return std::nullopt;
+    }
+
+    auto local_worker_() -> worker&
+    {
+        const auto index = local_index_();
+        if (not index) {
+            throw std::runtime_error(
+                log_message("jobs submitted from outside the scheduler!"sv));
+        }
+        return *workers_.at(*index);
+    }
+
+    inline auto find_job_(worker& self) -> job*
+    {
+        if (auto j = self.deque.pop()) {
+            return j;
+        }
+        const auto count = static_cast<uint32_t>(workers_.size());
+        const auto start = self.victims() % count;
+        for (uint32_t i = 0; i < count; ++i) {
+            auto& victim = *workers_[(start + i) % count];
+            if (std::addressof(victim) == std::addressof(self)) {
+                continue;
+            }
+            if (auto j = victim.deque.steal()) {
+                return j;
+            }
+        }
+        return nullptr;
+    }
+
+    static inline auto execute_(job& j)
+    {
+        auto done = j.done;
+        try {
+            j.invoke(j);
+        }
+        catch (...) {
+            done->fail(std::current_exception());
+        }
+        done->done();
+    }
+
+    inline auto wake_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_seq_cst) != 0) {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            epoch_.notify_one();
+        }
+    }
+
+    inline auto worker_loop_(uint32_t index)
+    {
+        current_      = {.owner = this, .index = index};
+        auto& self    = *workers_.at(index);
+        uint32_t idle = 0;
+        while (not stopping_.load(std::memory_order_relaxed)) {
+            if (auto j = find_job_(self)) {
+                idle = 0;
+                execute_(*j);
+                continue;
+            }
+            if (++idle < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            // announce the nap before the last look, so a push either sees
+            // the sleeper or happens before that look
+            sleeping_.fetch_add(1, std::memory_order_seq_cst);
+            const auto epoch = epoch_.load(std::memory_order_seq_cst);
+            auto j           = find_job_(self);
+            if (j == nullptr and not stopping_.load()) {
+                epoch_.wait(epoch, std::memory_order_seq_cst);
+            }
+            sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+            if (j != nullptr) {
+                execute_(*j);
+            }
+            idle = 0;
+        }
+    }
+
+  public:
+    inline explicit scheduler(
+        uint32_t worker_count = std::thread::hardware_concurrency())
+    {
+        worker_count = std::max(1u, worker_count);
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            workers_.push_back(std::make_unique<worker>());
+            workers_.back()->victims.seed(i + 1);
+        }
+        for (uint32_t i = 1; i < worker_count; ++i) {
+            threads_.emplace_back([this, i] { worker_loop_(i); });
+        }
+    }
+
+    scheduler(const scheduler&)            = delete;
+    scheduler& operator=(const scheduler&) = delete;
+
+    inline ~scheduler()
+    {
+        stopping_.store(true);
+        epoch_.fetch_add(1);
+        epoch_.notify_all();
+        threads_.clear();
+    }
+
+    auto worker_count() const
+    {
+        return static_cast<uint32_t>(workers_.size());
+    }
+
+    // j.done must already count j
+    inline auto submit(job& j)
+    {
+        if (not local_worker_().deque.push(std::addressof(j))) {
+            execute_(j);
+            return;
+        }
+        wake_();
+    }
+
+    // runs other jobs until done is reached, then rethrows the first error
+    inline auto wait(const counter& done)
+    {
+        auto& self = local_worker_();
+        while (not done.is_done()) {
+            if (auto j = find_job_(self)) {
+                execute_(*j);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        done.rethrow();
+    }
+
+    // calls body(first, last) over [0, count) split into chunks of at least
+    // grain items, the calling thread takes the first chunk
+    inline auto parallel_for(size_t count, size_t grain, auto&& body)
+    {
+        if (count == 0) {
+            return;
+        }
+        const auto chunks = std::clamp<size_t>(
+            count / std::max<size_t>(grain, 1), 1, 4 * workers_.size());
+        if (chunks == 1) {
+            body(size_t{0}, count);
+            return;
+        }
+        auto call = [&body](size_t first, size_t last) { body(first, last); };
+        // jobs live on the stack unless there are a lot of workers
+        std::array<std::byte, 64 * sizeof(job)> storage;
+        std::pmr::monotonic_buffer_resource resource{storage.data(),
+                                                     storage.size()};
+        std::pmr::vector<job> chunk_jobs(chunks, std::addressof(resource));
+        counter done{static_cast<uint32_t>(chunks - 1)};
+        for (size_t chunk = 1; chunk < chunks; ++chunk) {
+            chunk_jobs[chunk] = {
+                .invoke =
+                    [](job& j) {
+                        (*static_cast<decltype(call)*>(j.context))(j.first,
+                                                                   j.last);
+                    },
+                .context = std::addressof(call),
+                .first   = count * chunk / chunks,
+                .last    = count * (chunk + 1) / chunks,
+                .done    = std::addressof(done)};
+            submit(chunk_jobs[chunk]);
+        }
+        try {
+            call(0, count / chunks);
+        }
+        catch (...) {
+            done.fail(std::current_exception());
+        }
+        wait(done);
+    }
+};
+
+// sized to the machine, shared by everything rendering a frame; the first
+// thread asking for it becomes its worker 0
+inline auto global_scheduler() -> scheduler&
+{
+    static scheduler instance;
+    return instance;
+}
+
+// nodes are added once and the graph is run as many times as needed; a node
+// starts once all of its predecessors finished, as their continuation on
+// whichever worker finished last
+class task_graph {
+  public:
+    using node_id = size_t;
+
+  private:
+    struct node {
+        task_graph* graph;
+        const char* name;
+        std::move_only_function<void()> work;
+        std::vector<node_id> successors;
+        uint32_t dependencies = 0;
+        std::atomic<uint32_t> pending{0};
+        job task;
+    };
+
+    std::vector<std::unique_ptr<node>> nodes_;
+    scheduler* scheduler_ = nullptr;
+    counter* done_        = nullptr;
+
+    static inline auto run_node_(job& j)
+    {
+        auto& n = *static_cast<node*>(j.context);
+        // once a node threw the rest of the run is skipped, successors are
+        // still released so the counter drains
+        if (not n.graph->done_->failed()) {
+            profiler::scoped_zone zone{n.name};
+            try {
+                n.work();
+            }
+            catch (...) {
+                n.graph->done_->fail(std::current_exception());
+            }
+        }
+        for (auto successor : n.successors) {
+            auto& next = *n.graph->nodes_.at(successor);
+            if (next.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                n.graph->scheduler_->submit(next.task);
+            }
+        }
+    }
+
+  public:
+    // name has to be a string literal, it names the node's profiling zone
+    inline auto add(const char* name, std::move_only_function<void()> work)
+        -> node_id
+    {
+        auto n   = std::make_unique<node>();
+        n->graph = this;
+        n->name  = name;
+        n->work  = std::move(work);
+        nodes_.push_back(std::move(n));
+        return nodes_.size() - 1;
+    }
+
+    inline auto precede(node_id before, node_id after)
+    {
+        nodes_.at(before)->successors.push_back(after);
+        ++nodes_.at(after)->dependencies;
+    }
+
+    // blocks until every node ran, the calling thread helps; rethrows the
+    // first exception of a node
+    inline auto run(scheduler& workers)
+    {
+        counter done{static_cast<uint32_t>(nodes_.size())};
+        scheduler_ = std::addressof(workers);
+        done_      = std::addressof(done);
+        for (auto& n : nodes_) {
+            n->pending.store(n->dependencies, std::memory_order_relaxed);
+            n->task = {.invoke  = run_node_,
+                       .context = n.get(),
+                       .done    = std::addressof(done)};
+        }
+        for (auto& n : nodes_) {
+            if (n->dependencies == 0) {
+                workers.submit(n->task);
+            }
+        }
+        workers.wait(done);
+    }
+};
+} // namespace antartar::jobs
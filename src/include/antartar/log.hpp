@@ -1,12 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <fmt/format.h>
+#include <memory>
+#include <mutex>
 #include <source_location>
 #include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace std::string_view_literals;
 
 namespace antartar {
+enum class severity : uint8_t { debug, info, warning, error };
+
+// messages below this level compile out, debug builds keep everything
+#ifndef ANTARTAR_LOG_LEVEL
+#define ANTARTAR_LOG_LEVEL (ANTARTAR_IS_DEBUG ? 0 : 1)
+#endif
+constexpr auto min_severity = static_cast<severity>(ANTARTAR_LOG_LEVEL);
+
 inline auto
 log_message(std::convertible_to<std::string_view> auto message,
             std::source_location current_loc = std::source_location::current())
@@ -17,11 +37,345 @@ log_message(std::convertible_to<std::string_view> auto message,
                        message);
 }
 
+namespace logging {
+struct record {
+    static constexpr size_t text_capacity = 224;
+
+    uint64_t sequence;
+    const char* file;
+    uint32_t line;
+    severity level;
+    uint16_t size;
+    // the message goes on in the next record
+    bool continued;
+    // the ring filled up before the rest of the message fit
+    bool truncated;
+    std::array<char, text_capacity> text;
+};
+
+// single producer (the owning thread), single consumer (whoever holds the
+// logger's drain lock); messages longer than a record spill into the records
+// after it and are published together, messages that don't fit in a full
+// ring are dropped and counted
+class thread_ring {
+  public:
+    static constexpr size_t capacity = 512;
+
+  private:
+    std::unique_ptr<record[]> records_{new record[capacity]};
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> dropped_{0};
+
+  public:
+    thread_ring* next = nullptr;
+
+    // the index-th unpublished slot, nullptr when the ring can't hold it
+    inline auto claim(size_t index) -> record*
+    {
+        const auto head = head_.load(std::memory_order_relaxed) + index;
+        if (head - tail_.load(std::memory_order_acquire) >= capacity) {
+            return nullptr;
+        }
+        return std::addressof(records_[head % capacity]);
+    }
+
+    // returns the slot to format into, nullptr when full
+    inline auto begin_push() -> record*
+    {
+        const auto slot = claim(0);
+        if (slot == nullptr) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return slot;
+    }
+
+    // publishes the first count claimed slots
+    inline auto end_push(size_t count = 1)
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + count,
+                    std::memory_order_release);
+    }
+
+    inline auto drain(auto&& callback)
+    {
+        const auto head = head_.load(std::memory_order_acquire);
+        auto tail       = tail_.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            callback(records_[tail % capacity]);
+        }
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    auto take_dropped() { return dropped_.exchange(0); }
+};
+
+// owns the rings of every thread that logged and the thread writing them
+// out; records are merged across threads by a global sequence number
+class logger {
+  private:
+    static constexpr auto flush_period = std::chrono::milliseconds{2};
+
+    std::atomic<thread_ring*> head_{nullptr};
+    std::atomic<uint64_t> sequence_{0};
+    std::mutex drain_mutex_;
+    std::vector<record> batch_;
+    fmt::memory_buffer out_;
+    fmt::memory_buffer err_;
+    std::jthread flusher_;
+
+    // continuation records append to the line the previous one started
+    inline auto write_(const record& r, bool continuation)
+    {
+        auto& out = r.level >= severity::warning ? err_ : out_;
+        if (not continuation) {
+            fmt::format_to(std::back_inserter(out),
+                           "[file: {}][line: {}] ",
+                           r.file,
+                           r.line);
+        }
+        out.append(std::string_view{r.text.data(), r.size});
+        if (r.continued) {
+            return;
+        }
+        out.append(r.truncated ? " [truncated]\n"sv : "\n"sv);
+    }
+
+    inline auto flush_streams_()
+    {
+        if (out_.size() != 0) {
+            std::fwrite(out_.data(), 1, out_.size(), stdout);
+            std::fflush(stdout);
+            out_.clear();
+        }
+        if (err_.size() != 0) {
+            std::fwrite(err_.data(), 1, err_.size(), stderr);
+            err_.clear();
+        }
+    }
+
+    inline auto drain_() -> bool
+    {
+        std::scoped_lock lock{drain_mutex_};
+        batch_.clear();
+        size_t dropped = 0;
+        for (auto ring = head_.load(std::memory_order_acquire);
+             ring != nullptr;
+             ring = ring->next) {
+            ring->drain([this](const record& r) { batch_.push_back(r); });
+            dropped += ring->take_dropped();
+        }
+        // parts of a message take consecutive sequence numbers, so they stay
+        // together
+        std::ranges::sort(batch_, {}, &record::sequence);
+        auto continuation = false;
+        for (const auto& r : batch_) {
+            write_(r, continuation);
+            continuation = r.continued;
+        }
+        if (dropped != 0) {
+            fmt::format_to(std::back_inserter(err_),
+                           "log: dropped {} messages, ring full\n",
+                           dropped);
+        }
+        flush_streams_();
+        return not batch_.empty();
+    }
+
+  public:
+    inline logger()
+    {
+        batch_.reserve(4 * thread_ring::capacity);
+        flusher_ = std::jthread{[this](std::stop_token stop) {
+            while (not stop.stop_requested()) {
+                if (not drain_()) {
+                    std::this_thread::sleep_for(flush_period);
+                }
+            }
+        }};
+    }
+
+    inline ~logger()
+    {
+        flusher_.request_stop();
+        flusher_.join();
+        drain_();
+        auto ring = head_.load();
+        while (ring != nullptr) {
+            delete std::exchange(ring, ring->next);
+        }
+    }
+
+    inline auto register_thread() -> thread_ring&
+    {
+        auto ring  = new thread_ring;
+        ring->next = head_.load(std::memory_order_relaxed);
+        while (not head_.compare_exchange_weak(ring->next,
+                                               ring,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+        return *ring;
+    }
+
+    // first of count consecutive sequence numbers
+    auto next_sequence(uint64_t count = 1)
+    {
+        return sequence_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // writes out everything logged so far on the calling thread
+    inline auto flush() { drain_(); }
+};
+
+inline auto global_logger() -> logger&
+{
+    static logger instance;
+    return instance;
+}
+
+inline auto local_ring() -> thread_ring&
+{
+    thread_local thread_ring& ring = global_logger().register_thread();
+    return ring;
+}
+
+// output iterator writing a message across consecutive claimed records,
+// dropping what's left once the ring is full
+class spill_writer {
+  public:
+    struct state {
+        thread_ring& ring;
+        record* current;
+        size_t parts   = 1;
+        size_t size    = 0;
+        bool truncated = false;
+    };
+
+  private:
+    state* state_;
+
+  public:
+    using difference_type = std::ptrdiff_t;
+
+    explicit spill_writer(state& s) : state_{std::addressof(s)} {}
+
+    inline auto operator=(char c) -> spill_writer&
+    {
+        auto& s = *state_;
+        if (s.truncated) {
+            return *this;
+        }
+        if (s.size == record::text_capacity) {
+            const auto next = s.ring.claim(s.parts);
+            if (next == nullptr) {
+                s.truncated = true;
+                return *this;
+            }
+            s.current->size      = static_cast<uint16_t>(s.size);
+            s.current->continued = true;
+            s.current            = next;
+            s.size               = 0;
+            ++s.parts;
+        }
+        s.current->text[s.size++] = c;
+        return *this;
+    }
+
+    auto operator*() -> spill_writer& { return *this; }
+    auto operator++() -> spill_writer& { return *this; }
+    auto operator++(int) -> spill_writer { return *this; }
+};
+
+template<typename... Args>
+inline auto submit(severity level,
+                   const std::source_location& loc,
+                   fmt::format_string<Args...> format,
+                   Args&&... args)
+{
+    auto& ring = local_ring();
+    auto slot  = ring.begin_push();
+    if (slot == nullptr) {
+        return;
+    }
+    // args stay lvalues, a long message formats them a second time
+    const auto arguments = fmt::make_format_args(args...);
+    const auto result    = fmt::vformat_to_n(slot->text.data(),
+                                          slot->text.size(),
+                                          format,
+                                          arguments);
+    slot->size      = static_cast<uint16_t>(
+        std::min(result.size, slot->text.size()));
+    slot->continued = false;
+    size_t parts    = 1;
+    auto truncated  = false;
+    if (result.size > slot->text.size()) {
+        // rare, formatted again from the start into as many records as needed
+        spill_writer::state spill{.ring = ring, .current = slot};
+        fmt::vformat_to(spill_writer{spill}, format, arguments);
+        spill.current->size      = static_cast<uint16_t>(spill.size);
+        spill.current->continued = false;
+        parts                    = spill.parts;
+        truncated                = spill.truncated;
+    }
+    const auto sequence = global_logger().next_sequence(parts);
+    for (size_t part = 0; part < parts; ++part) {
+        auto r       = ring.claim(part);
+        r->sequence  = sequence + part;
+        r->file      = loc.file_name();
+        r->line      = loc.line();
+        r->level     = level;
+        r->truncated = truncated;
+    }
+    ring.end_push(parts);
+}
+
+// format string that also captures where log was called from
+template<typename... Args> struct located_format {
+    fmt::format_string<Args...> format;
+    std::source_location location;
+
+    template<std::convertible_to<std::string_view> S>
+    consteval located_format(
+        const S& s,
+        std::source_location loc = std::source_location::current())
+        : format{s}, location{loc}
+    {
+    }
+};
+} // namespace logging
+
+// plain message, log("...") or log<severity::warning>(message)
+template<severity level = severity::info>
 inline auto
 log(std::convertible_to<std::string_view> auto message,
     std::source_location current_loc = std::source_location::current())
 {
-    auto output = log_message(message, current_loc);
-    fmt::print("{}\n", output);
+    if constexpr (level >= min_severity) {
+        logging::submit(level,
+                        current_loc,
+                        "{}",
+                        std::string_view{message});
+    }
 }
-} // namespace antartar
\ No newline at end of file
+
+// formats straight into the thread's ring, no allocation on the caller side
+template<severity level = severity::info, typename Arg, typename... Args>
+inline auto
+log(logging::located_format<std::type_identity_t<Arg>,
+                            std::type_identity_t<Args>...> format,
+    Arg&& arg,
+    Args&&... args)
+{
+    if constexpr (level >= min_severity) {
+        logging::submit(level,
+                        format.location,
+                        format.format,
+                        std::forward<Arg>(arg),
+                        std::forward<Args>(args)...);
+    }
+}
+
+// blocks until everything logged so far is written
+inline auto flush_log() { logging::global_logger().flush(); }
+} // namespace antartar
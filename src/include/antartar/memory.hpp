@@ -0,0 +1,459 @@
+#pragma once
+#include <antartar/log.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <fmt/format.h>
+#include <optional>
+#include <range/v3/all.hpp>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// power-of-two buddy allocator working purely on offsets, every block of
+// order k is (min_block_size << k) bytes and naturally aligned to its size
+class buddy_free_list {
+  private:
+    VkDeviceSize size_           = 0;
+    VkDeviceSize min_block_size_ = 0;
+    uint32_t top_order_          = 0;
+    std::vector<std::set<VkDeviceSize>> free_lists_;
+    std::unordered_map<VkDeviceSize, uint32_t> allocated_orders_;
+    VkDeviceSize bytes_allocated_ = 0;
+
+    auto block_size_(uint32_t order) const { return min_block_size_ << order; }
+
+    auto order_for_(VkDeviceSize size) const -> uint32_t
+    {
+        const auto rounded = std::bit_ceil(std::max(size, min_block_size_));
+        return static_cast<uint32_t>(std::countr_zero(rounded)
+                                     - std::countr_zero(min_block_size_));
+    }
+
+  public:
+    buddy_free_list() = default;
+
+    inline buddy_free_list(VkDeviceSize size, VkDeviceSize min_block_size)
+        : size_{size},
+          min_block_size_{min_block_size}
+    {
+        if (not std::has_single_bit(size)
+            or not std::has_single_bit(min_block_size)
+            or size < min_block_size) {
+            throw std::runtime_error(log_message(
+                "buddy block sizes have to be powers of two!"sv));
+        }
+        top_order_ = order_for_(size);
+        free_lists_.resize(top_order_ + 1);
+        free_lists_.at(top_order_).insert(0);
+    }
+
+    inline auto allocate(VkDeviceSize size, VkDeviceSize alignment)
+        -> std::optional<VkDeviceSize>
+    {
+        const auto order = order_for_(std::max(size, alignment));
+        if (order > top_order_) {
+            return std::nullopt;
+        }
+        auto available = order;
+        while (available <= top_order_ and free_lists_.at(available).empty()) {
+            ++available;
+        }
+        if (available > top_order_) {
+            return std::nullopt;
+        }
+        // lowest offset first keeps the tail of the block free for large
+        // requests
+        auto& list        = free_lists_.at(available);
+        const auto offset = *list.begin();
+        list.erase(list.begin());
+        while (available > order) {
+            --available;
+            free_lists_.at(available).insert(offset + block_size_(available));
+        }
+        allocated_orders_.emplace(offset, order);
+        bytes_allocated_ += block_size_(order);
+        return offset;
+    }
+
+    inline auto free(VkDeviceSize offset)
+    {
+        auto allocated = allocated_orders_.find(offset);
+        if (allocated == std::end(allocated_orders_)) {
+            throw std::runtime_error(
+                log_message("freeing offset not owned by buddy allocator!"sv));
+        }
+        auto order = allocated->second;
+        allocated_orders_.erase(allocated);
+        bytes_allocated_ -= block_size_(order);
+
+        while (order < top_order_) {
+            const auto buddy = offset ^ block_size_(order);
+            auto& list       = free_lists_.at(order);
+            if (auto it = list.find(buddy); it != std::end(list)) {
+                list.erase(it);
+                offset = std::min(offset, buddy);
+                ++order;
+            }
+            else {
+                break;
+            }
+        }
+        free_lists_.at(order).insert(offset);
+    }
+
+    auto size() const { return size_; }
+
+    auto empty() const { return allocated_orders_.empty(); }
+
+    auto allocation_count() const
+    {
+        return static_cast<uint32_t>(allocated_orders_.size());
+    }
+
+    auto bytes_allocated() const { return bytes_allocated_; }
+
+    inline auto largest_free_range() const -> VkDeviceSize
+    {
+        for (auto order = top_order_ + 1; order-- > 0;) {
+            if (not free_lists_.at(order).empty()) {
+                return block_size_(order);
+            }
+        }
+        return 0;
+    }
+
+    inline auto free_range_count() const
+    {
+        uint32_t count = 0;
+        for (const auto& list : free_lists_) {
+            count += static_cast<uint32_t>(list.size());
+        }
+        return count;
+    }
+};
+
+struct memory_allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset   = 0;
+    VkDeviceSize size     = 0;
+    // host address of offset, only for host visible memory
+    void* mapped         = nullptr;
+    uint32_t memory_type = 0;
+    uint32_t block       = 0;
+};
+
+struct memory_stats {
+    uint32_t block_count            = 0;
+    uint32_t dedicated_block_count  = 0;
+    uint32_t allocation_count       = 0;
+    VkDeviceSize bytes_reserved     = 0;
+    VkDeviceSize bytes_requested    = 0;
+    VkDeviceSize bytes_allocated    = 0;
+    VkDeviceSize largest_free_range = 0;
+    uint32_t free_range_count       = 0;
+
+    // space lost to rounding sub-allocations up to buddy sizes
+    auto internal_fragmentation() const
+    {
+        return bytes_allocated == 0
+                   ? 0.
+                   : 1. - static_cast<double>(bytes_requested)
+                              / static_cast<double>(bytes_allocated);
+    }
+
+    // free space that can't be handed out as one contiguous range
+    auto external_fragmentation() const
+    {
+        const auto bytes_free = bytes_reserved - bytes_allocated;
+        return bytes_free == 0
+                   ? 0.
+                   : 1. - static_cast<double>(largest_free_range)
+                              / static_cast<double>(bytes_free);
+    }
+};
+
+class memory_allocator {
+  public:
+    static constexpr VkDeviceSize default_block_size = 64ull << 20;
+    static constexpr VkDeviceSize min_block_size     = 256;
+
+  private:
+    struct block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        buddy_free_list free_list;
+        void* mapped           = nullptr;
+        bool dedicated         = false;
+        VkDeviceSize requested = 0;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties_{};
+    VkDeviceSize min_allocation_size_ = min_block_size;
+    std::array<std::vector<block>, VK_MAX_MEMORY_TYPES> blocks_;
+
+    inline auto block_size_for_(uint32_t memory_type) const -> VkDeviceSize
+    {
+        const auto heap_index =
+            memory_properties_.memoryTypes[memory_type].heapIndex;
+        const auto heap_size = memory_properties_.memoryHeaps[heap_index].size;
+        // small heaps (e.g. 256MB BAR) would be eaten by a few big blocks
+        return std::min(default_block_size,
+                        std::bit_floor(std::max(heap_size / 8,
+                                                min_allocation_size_)));
+    }
+
+    inline auto is_host_visible_(uint32_t memory_type) const
+    {
+        return (memory_properties_.memoryTypes[memory_type].propertyFlags
+                & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+               != 0;
+    }
+
+    inline auto create_block_(uint32_t memory_type,
+                              VkDeviceSize size,
+                              bool dedicated) -> uint32_t
+    {
+        VkMemoryAllocateInfo alloc_info{
+            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize  = size,
+            .memoryTypeIndex = memory_type};
+
+        block new_block{.dedicated = dedicated};
+        if (VK_SUCCESS
+            != vkAllocateMemory(device_,
+                                std::addressof(alloc_info),
+                                nullptr,
+                                std::addressof(new_block.memory))) {
+            throw std::runtime_error(
+                log_message("failed to allocate device memory block!"sv));
+        }
+        if (is_host_visible_(memory_type)) {
+            // persistently mapped, callers get a pointer into the block
+            if (VK_SUCCESS
+                != vkMapMemory(device_,
+                               new_block.memory,
+                               0,
+                               VK_WHOLE_SIZE,
+                               0,
+                               std::addressof(new_block.mapped))) {
+                vkFreeMemory(device_, new_block.memory, nullptr);
+                throw std::runtime_error(
+                    log_message("failed to map device memory block!"sv));
+            }
+        }
+        if (not dedicated) {
+            new_block.free_list = buddy_free_list{size, min_allocation_size_};
+        }
+
+        auto& blocks = blocks_.at(memory_type);
+        auto slot    = ranges::find_if(blocks, [](const block& b) {
+            return b.memory == VK_NULL_HANDLE;
+        });
+        if (slot != std::end(blocks)) {
+            *slot = std::move(new_block);
+            return static_cast<uint32_t>(
+                std::distance(std::begin(blocks), slot));
+        }
+        blocks.push_back(std::move(new_block));
+        return static_cast<uint32_t>(blocks.size() - 1);
+    }
+
+    inline auto destroy_block_(block& b)
+    {
+        if (b.memory == VK_NULL_HANDLE) {
+            return;
+        }
+        if (b.mapped != nullptr) {
+            vkUnmapMemory(device_, b.memory);
+        }
+        vkFreeMemory(device_, b.memory, nullptr);
+        b = block{};
+    }
+
+    inline auto mapped_at_(const block& b, VkDeviceSize offset) const -> void*
+    {
+        return b.mapped == nullptr ? nullptr
+                                   : static_cast<std::byte*>(b.mapped) + offset;
+    }
+
+  public:
+    inline memory_allocator(VkPhysicalDevice physical_device, VkDevice device)
+        : device_{device}
+    {
+        vkGetPhysicalDeviceMemoryProperties(physical_device,
+                                            std::addressof(memory_properties_));
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device,
+                                      std::addressof(properties));
+        // buffers and optimal images never share a granularity page when every
+        // sub-allocation spans whole pages
+        min_allocation_size_ = std::bit_ceil(
+            std::max(min_block_size, properties.limits.bufferImageGranularity));
+    }
+
+    memory_allocator(const memory_allocator&)            = delete;
+    memory_allocator& operator=(const memory_allocator&) = delete;
+
+    inline ~memory_allocator()
+    {
+        for (auto& blocks : blocks_) {
+            ranges::for_each(blocks, [this](block& b) { destroy_block_(b); });
+        }
+    }
+
+    inline auto find_memory_type(uint32_t type_filter,
+                                 VkMemoryPropertyFlags properties) const
+        -> uint32_t
+    {
+        for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; ++i) {
+            if ((type_filter & (1 << i))
+                and ((memory_properties_.memoryTypes[i].propertyFlags
+                      & properties)
+                     == properties)) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    inline auto allocate(const VkMemoryRequirements& requirements,
+                         VkMemoryPropertyFlags properties) -> memory_allocation
+    {
+        const auto memory_type =
+            find_memory_type(requirements.memoryTypeBits, properties);
+        const auto block_size = block_size_for_(memory_type);
+        auto& blocks          = blocks_.at(memory_type);
+
+        if (requirements.size > block_size / 2) {
+            const auto index = create_block_(memory_type,
+                                             requirements.size,
+                                             /*dedicated=*/true);
+            auto& b          = blocks.at(index);
+            b.requested      = requirements.size;
+            return {.memory      = b.memory,
+                    .offset      = 0,
+                    .size        = requirements.size,
+                    .mapped      = b.mapped,
+                    .memory_type = memory_type,
+                    .block       = index};
+        }
+
+        auto sub_allocate =
+            [&](uint32_t index) -> std::optional<memory_allocation> {
+            auto& b = blocks.at(index);
+            if (b.memory == VK_NULL_HANDLE or b.dedicated) {
+                return std::nullopt;
+            }
+            auto offset =
+                b.free_list.allocate(requirements.size, requirements.alignment);
+            if (not offset) {
+                return std::nullopt;
+            }
+            b.requested += requirements.size;
+            return memory_allocation{.memory      = b.memory,
+                                     .offset      = *offset,
+                                     .size        = requirements.size,
+                                     .mapped      = mapped_at_(b, *offset),
+                                     .memory_type = memory_type,
+                                     .block       = index};
+        };
+
+        for (uint32_t index = 0; index < blocks.size(); ++index) {
+            if (auto allocation = sub_allocate(index)) {
+                return *allocation;
+            }
+        }
+        if (auto allocation = sub_allocate(
+                create_block_(memory_type, block_size, /*dedicated=*/false))) {
+            return *allocation;
+        }
+        throw std::runtime_error(
+            log_message("failed to sub-allocate device memory!"sv));
+    }
+
+    inline auto free(memory_allocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+        auto& blocks = blocks_.at(allocation.memory_type);
+        auto& b      = blocks.at(allocation.block);
+        if (b.dedicated) {
+            destroy_block_(b);
+        }
+        else {
+            b.free_list.free(allocation.offset);
+            b.requested -= allocation.size;
+            // keep one empty block around per memory type so alternating
+            // create/destroy doesn't thrash vkAllocateMemory
+            auto is_spare = [&](const block& other) {
+                return std::addressof(other) != std::addressof(b)
+                       and other.memory != VK_NULL_HANDLE
+                       and not other.dedicated and other.free_list.empty();
+            };
+            if (b.free_list.empty() and ranges::any_of(blocks, is_spare)) {
+                destroy_block_(b);
+            }
+        }
+        allocation = memory_allocation{};
+    }
+
+    inline auto stats() const
+    {
+        memory_stats result;
+        for (const auto& blocks : blocks_) {
+            for (const auto& b : blocks) {
+                if (b.memory == VK_NULL_HANDLE) {
+                    continue;
+                }
+                ++result.block_count;
+                result.bytes_requested += b.requested;
+                if (b.dedicated) {
+                    ++result.dedicated_block_count;
+                    ++result.allocation_count;
+                    result.bytes_reserved += b.requested;
+                    result.bytes_allocated += b.requested;
+                    continue;
+                }
+                result.allocation_count += b.free_list.allocation_count();
+                result.bytes_reserved += b.free_list.size();
+                result.bytes_allocated += b.free_list.bytes_allocated();
+                result.free_range_count += b.free_list.free_range_count();
+                result.largest_free_range =
+                    std::max(result.largest_free_range,
+                             b.free_list.largest_free_range());
+            }
+        }
+        return result;
+    }
+};
+} // namespace antartar::vk
+
+template<> struct fmt::formatter<antartar::vk::memory_stats> {
+    constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+    auto format(const antartar::vk::memory_stats& stats,
+                format_context& ctx) const
+    {
+        return fmt::format_to(
+            ctx.out(),
+            "blocks: {} ({} dedicated), allocations: {}, reserved: {} B, "
+            "allocated: {} B, requested: {} B, free ranges: {}, "
+            "internal fragmentation: {:.2f}, external fragmentation: {:.2f}",
+            stats.block_count,
+            stats.dedicated_block_count,
+            stats.allocation_count,
+            stats.bytes_reserved,
+            stats.bytes_allocated,
+            stats.bytes_requested,
+            stats.free_range_count,
+            stats.internal_fragmentation(),
+            stats.external_fragmentation());
+    }
+};
@@ -0,0 +1,381 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <deque>
+#include <glm/glm.hpp>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace antartar::mesh {
+// most desktop gpus reuse about this many transformed vertices; a fifo of
+// this size is what the orderings below plan for and the stats measure
+constexpr uint32_t default_cache_size = 16;
+
+struct cache_stats {
+    // transformed vertices per triangle, 3 means no reuse and large
+    // regular grids approach 0.5
+    double acmr = 0.;
+    // transformed vertices per referenced vertex, 1 is ideal
+    double atvr = 0.;
+};
+
+struct fetch_stats {
+    // bytes of vertex buffer lines loaded per byte of referenced vertices,
+    // 1 is ideal
+    double overfetch = 0.;
+};
+
+// a fifo post transform cache run over the triangles in order
+template<std::unsigned_integral I>
+inline auto analyze_vertex_cache(std::span<const I> indices,
+                                 size_t vertex_count,
+                                 uint32_t cache_size = default_cache_size)
+    -> cache_stats
+{
+    // a vertex is cached while fewer than cache_size misses followed its
+    // own
+    std::vector<uint64_t> cached_at(vertex_count, 0);
+    std::vector<bool> referenced(vertex_count);
+    uint64_t time           = cache_size + 1;
+    size_t misses           = 0;
+    size_t referenced_count = 0;
+    for (const auto index : indices) {
+        if (time - cached_at[index] > cache_size) {
+            cached_at[index] = time++;
+            ++misses;
+        }
+        if (not referenced[index]) {
+            referenced[index] = true;
+            ++referenced_count;
+        }
+    }
+    const auto triangles = indices.size() / 3;
+    return {.acmr = triangles > 0 ? static_cast<double>(misses)
+                                        / static_cast<double>(triangles)
+                                  : 0.,
+            .atvr = referenced_count > 0
+                        ? static_cast<double>(misses)
+                              / static_cast<double>(referenced_count)
+                        : 0.};
+}
+
+// every transform cache miss fetches its vertex through a fifo of
+// line_count lines of line_size bytes
+template<std::unsigned_integral I>
+inline auto analyze_vertex_fetch(std::span<const I> indices,
+                                 size_t vertex_count,
+                                 size_t vertex_size,
+                                 uint32_t cache_size = default_cache_size,
+                                 size_t line_size    = 64,
+                                 size_t line_count   = 64) -> fetch_stats
+{
+    std::vector<uint64_t> cached_at(vertex_count, 0);
+    std::vector<bool> referenced(vertex_count);
+    std::deque<size_t> lines;
+    uint64_t time           = cache_size + 1;
+    size_t loaded           = 0;
+    size_t referenced_count = 0;
+    for (const auto index : indices) {
+        if (not referenced[index]) {
+            referenced[index] = true;
+            ++referenced_count;
+        }
+        if (time - cached_at[index] <= cache_size) {
+            continue;
+        }
+        cached_at[index] = time++;
+        const auto first = index * vertex_size / line_size;
+        const auto last  = ((index + 1) * vertex_size - 1) / line_size;
+        for (auto line = first; line <= last; ++line) {
+            if (std::ranges::find(lines, line) != std::end(lines)) {
+                continue;
+            }
+            lines.push_back(line);
+            if (lines.size() > line_count) {
+                lines.pop_front();
+            }
+            ++loaded;
+        }
+    }
+    const auto bytes = referenced_count * vertex_size;
+    return {.overfetch = bytes > 0 ? static_cast<double>(loaded * line_size)
+                                         / static_cast<double>(bytes)
+                                   : 0.};
+}
+
+namespace detail {
+// the triangles around every vertex, offsets into one flat list
+struct adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+template<std::unsigned_integral I>
+inline auto build_adjacency(std::span<const I> indices, size_t vertex_count)
+{
+    adjacency result{.offsets   = std::vector<uint32_t>(vertex_count + 1),
+                     .triangles = std::vector<uint32_t>(indices.size())};
+    for (const auto index : indices) {
+        ++result.offsets[index + 1];
+    }
+    std::partial_sum(std::begin(result.offsets),
+                     std::end(result.offsets),
+                     std::begin(result.offsets));
+    auto next = result.offsets;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        result.triangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    return result;
+}
+} // namespace detail
+
+// Sander, Nehab and Barczak's tipsify: emits every triangle around a fan
+// vertex, then moves to the vertex just emitted that stays cached through
+// its remaining triangles, or back to a dead end when none does; linear in
+// the index count and within a few percent of the slower optimal orders
+template<std::unsigned_integral I>
+inline auto optimize_vertex_cache(std::span<I> indices,
+                                  size_t vertex_count,
+                                  uint32_t cache_size = default_cache_size)
+{
+    const auto triangle_count = indices.size() / 3;
+    const auto around =
+        detail::build_adjacency(std::span<const I>{indices}, vertex_count);
+    std::vector<uint32_t> live(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        live[v] = around.offsets[v + 1] - around.offsets[v];
+    }
+    std::vector<int64_t> cached_at(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count);
+    std::vector<uint32_t> dead_ends;
+    std::vector<uint32_t> candidates;
+    std::vector<I> result;
+    result.reserve(indices.size());
+    int64_t time  = cache_size + 1;
+    size_t cursor = 0;
+
+    // the most recent vertex with triangles left, then any in input order
+    auto skip_dead_end = [&]() -> int64_t {
+        while (not dead_ends.empty()) {
+            const auto vertex = dead_ends.back();
+            dead_ends.pop_back();
+            if (live[vertex] > 0) {
+                return vertex;
+            }
+        }
+        for (; cursor < vertex_count; ++cursor) {
+            if (live[cursor] > 0) {
+                return static_cast<int64_t>(cursor);
+            }
+        }
+        return -1;
+    };
+
+    for (auto fan = skip_dead_end(); fan >= 0;) {
+        candidates.clear();
+        for (auto k = around.offsets[fan]; k < around.offsets[fan + 1]; ++k) {
+            const auto triangle = around.triangles[k];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (size_t corner = 0; corner < 3; ++corner) {
+                const auto vertex = indices[3 * triangle + corner];
+                result.push_back(vertex);
+                dead_ends.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                if (time - cached_at[vertex] > cache_size) {
+                    cached_at[vertex] = time++;
+                }
+            }
+        }
+        // the oldest candidate still cached after its remaining triangles
+        // pushed two new vertices each, it is the one about to be evicted
+        int64_t next = -1;
+        int64_t best = -1;
+        for (const auto vertex : candidates) {
+            if (live[vertex] == 0) {
+                continue;
+            }
+            const auto age = time - cached_at[vertex];
+            const auto priority =
+                age + 2 * static_cast<int64_t>(live[vertex]) <= cache_size
+                    ? age
+                    : 0;
+            if (priority > best) {
+                best = priority;
+                next = vertex;
+            }
+        }
+        fan = next >= 0 ? next : skip_dead_end();
+    }
+    std::ranges::copy(result, std::begin(indices));
+}
+
+// the overdraw half of tipsify, run on a vertex cache order: triangles are
+// cut into clusters where the cache starts over or a cluster's own miss
+// rate is back within threshold of its surroundings', then clusters facing
+// away from the mesh's center go first, they hide what is behind them from
+// most directions; costs threshold more misses at most
+template<std::unsigned_integral I>
+inline auto optimize_overdraw(std::span<I> indices,
+                              std::span<const glm::vec3> positions,
+                              float threshold     = 1.05f,
+                              uint32_t cache_size = default_cache_size)
+{
+    const auto triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+    // misses per triangle with a cache that is empty at first
+    std::vector<uint64_t> cached_at(positions.size(), 0);
+    uint64_t time = 0;
+    auto restart  = [&] { time += cache_size + 1; };
+    auto misses_of = [&](size_t triangle) {
+        uint32_t misses = 0;
+        for (size_t corner = 0; corner < 3; ++corner) {
+            const auto vertex = indices[3 * triangle + corner];
+            if (time - cached_at[vertex] > cache_size) {
+                cached_at[vertex] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    };
+
+    // a triangle missing all three vertices is where the order restarted
+    std::vector<size_t> hard{0};
+    restart();
+    for (size_t t = 0; t < triangle_count; ++t) {
+        if (misses_of(t) == 3 and t > 0) {
+            hard.push_back(t);
+        }
+    }
+    hard.push_back(triangle_count);
+
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h) {
+        const auto first = hard[h];
+        const auto last  = hard[h + 1];
+        restart();
+        size_t total = 0;
+        for (auto t = first; t < last; ++t) {
+            total += misses_of(t);
+        }
+        const auto target = threshold * static_cast<double>(total)
+                            / static_cast<double>(last - first);
+        clusters.push_back(first);
+        restart();
+        size_t misses = 0;
+        for (auto t = first; t < last; ++t) {
+            misses += misses_of(t);
+            const auto count = t + 1 - clusters.back();
+            if (t + 1 < last
+                and static_cast<double>(misses) / static_cast<double>(count)
+                        <= target) {
+                clusters.push_back(t + 1);
+                restart();
+                misses = 0;
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    // area weighted centroids and normals
+    struct cluster {
+        size_t first;
+        size_t last;
+        glm::vec3 centroid{0.f};
+        glm::vec3 normal{0.f};
+        float area = 0.f;
+        float key  = 0.f;
+    };
+    std::vector<cluster> sorted;
+    sorted.reserve(clusters.size() - 1);
+    glm::vec3 center{0.f};
+    auto area = 0.f;
+    for (size_t c = 0; c + 1 < clusters.size(); ++c) {
+        cluster current{.first = clusters[c], .last = clusters[c + 1]};
+        for (auto t = current.first; t < current.last; ++t) {
+            const auto a      = positions[indices[3 * t]];
+            const auto b      = positions[indices[3 * t + 1]];
+            const auto d      = positions[indices[3 * t + 2]];
+            const auto normal = glm::cross(b - a, d - a);
+            const auto weight = glm::length(normal);
+            current.normal += normal;
+            current.centroid += (a + b + d) * (weight / 3.f);
+            current.area += weight;
+        }
+        center += current.centroid;
+        area   += current.area;
+        sorted.push_back(current);
+    }
+    if (area <= 0.f) {
+        return;
+    }
+    center = center / area;
+    for (auto& c : sorted) {
+        const auto length = glm::length(c.normal);
+        if (c.area > 0.f and length > 0.f) {
+            c.key = glm::dot(c.centroid / c.area - center, c.normal / length);
+        }
+    }
+    std::ranges::stable_sort(
+        sorted, [](const auto& a, const auto& b) { return a.key > b.key; });
+    std::vector<I> result;
+    result.reserve(indices.size());
+    for (const auto& c : sorted) {
+        result.insert(std::end(result),
+                      std::begin(indices) + 3 * c.first,
+                      std::begin(indices) + 3 * c.last);
+    }
+    std::ranges::copy(result, std::begin(indices));
+}
+
+// vertices in the order the indices first use them, so fetches stream
+// through the buffer; unreferenced vertices are dropped
+template<typename V, std::unsigned_integral I>
+inline auto optimize_vertex_fetch(std::span<I> indices,
+                                  std::vector<V>& vertices)
+{
+    constexpr auto unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<V> ordered;
+    ordered.reserve(vertices.size());
+    for (auto& index : indices) {
+        auto& target = remap[index];
+        if (target == unused) {
+            target = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = static_cast<I>(target);
+    }
+    vertices = std::move(ordered);
+}
+
+// the whole stage a mesh goes through before it is uploaded, in the order
+// each step keeps the previous one's gains; position_of maps a vertex to
+// the position the overdraw order uses
+template<typename V, std::unsigned_integral I>
+inline auto optimize(std::vector<I>& indices,
+                     std::vector<V>& vertices,
+                     auto position_of,
+                     uint32_t cache_size = default_cache_size)
+{
+    optimize_vertex_cache(std::span{indices}, vertices.size(), cache_size);
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const auto& v : vertices) {
+        positions.push_back(position_of(v));
+    }
+    optimize_overdraw(std::span{indices},
+                      std::span<const glm::vec3>{positions},
+                      1.05f,
+                      cache_size);
+    optimize_vertex_fetch(std::span{indices}, vertices);
+}
+} // namespace antartar::mesh
@@ -0,0 +1,682 @@
+#pragma once
+#include <antartar/jobs.hpp>
+#include <antartar/log.hpp>
+#include <antartar/simd.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <numbers>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace antartar::ocean {
+inline constexpr float gravity = 9.81f;
+
+enum class spectrum_kind { phillips, jonswap };
+
+struct parameters {
+    // samples per side, a power of two of at least 8
+    uint32_t size = 256;
+    // meters per side, the tile repeats seamlessly
+    float patch_length = 250.f;
+    // meters per second 10 m above the water, waves travel along the direction
+    float wind_speed         = 15.f;
+    glm::vec2 wind_direction = {1.f, 0.f};
+    spectrum_kind spectrum   = spectrum_kind::jonswap;
+    // meters of open water upwind, jonswap only
+    float fetch = 100'000.f;
+    // scales the spectrum's energy
+    float amplitude = 1.f;
+    // scales horizontal displacement, 0 keeps the grid regular
+    float choppiness = 1.f;
+    // seconds until the surface loops, frequencies are quantized to it
+    float repeat_period = 200.f;
+    uint32_t seed       = 1;
+};
+
+// one grid point of the surface, laid out to be read as vertex attributes
+struct sample {
+    // horizontal offsets from the grid position in x and z, the height in y
+    glm::vec3 displacement;
+    // height derivatives along x and z, the normal is
+    // normalize(-slope.x, 1, -slope.y)
+    glm::vec2 slope;
+};
+static_assert(sizeof(sample) == 20);
+
+// cos² around the wind and nothing against it, integrates to 1 over angles
+inline auto spreading(glm::vec2 k, const parameters& p) -> float
+{
+    const auto& wind     = p.wind_direction;
+    const auto cos_theta = glm::dot(k, wind)
+                           / std::sqrt(glm::dot(k, k) * glm::dot(wind, wind));
+    if (not(cos_theta > 0.f)) {
+        return 0.f;
+    }
+    return 2.f / std::numbers::pi_v<float> * cos_theta * cos_theta;
+}
+
+// Phillips' saturation range as Tessendorf uses it, the longest waves the
+// wind raises are u²/g and ripples under a thousandth of that are damped
+inline auto phillips(glm::vec2 k, const parameters& p) -> float
+{
+    const auto k2 = glm::dot(k, k);
+    if (k2 == 0.f) {
+        return 0.f;
+    }
+    constexpr auto alpha = 0.0081f;
+    const auto longest   = p.wind_speed * p.wind_speed / gravity;
+    const auto shortest  = longest / 1000.f;
+    return p.amplitude * alpha / 2.f / (k2 * k2)
+           * std::exp(-1.f / (k2 * longest * longest))
+           * std::exp(-k2 * shortest * shortest) * spreading(k, p);
+}
+
+// fetch limited wind sea after Hasselmann et al., the frequency spectrum
+// moved onto wave vectors through dω/dk = g / 2ω and the polar k dk dθ
+inline auto jonswap(glm::vec2 k, const parameters& p) -> float
+{
+    const auto k2 = glm::dot(k, k);
+    if (k2 == 0.f) {
+        return 0.f;
+    }
+    const auto length = std::sqrt(k2);
+    const auto omega  = std::sqrt(gravity * length);
+    const auto u      = p.wind_speed;
+    const auto alpha
+        = 0.076f * std::pow(u * u / (p.fetch * gravity), 0.22f);
+    const auto peak  = 22.f * std::cbrt(gravity * gravity / (u * p.fetch));
+    const auto sigma = omega <= peak ? 0.07f : 0.09f;
+    const auto detune = (omega - peak) / (sigma * peak);
+    const auto enhancement = std::pow(3.3f, std::exp(-detune * detune / 2.f));
+    const auto ratio       = peak / omega;
+    const auto energy      = alpha * gravity * gravity / std::pow(omega, 5.f)
+                        * std::exp(-1.25f * ratio * ratio * ratio * ratio)
+                        * enhancement;
+    return p.amplitude * energy * gravity / (2.f * omega) / length
+           * spreading(k, p);
+}
+
+inline auto spectrum(glm::vec2 k, const parameters& p) -> float
+{
+    return p.spectrum == spectrum_kind::phillips ? phillips(k, p)
+                                                 : jonswap(k, p);
+}
+
+// throws unless a surface can be simulated with p
+inline auto validate(const parameters& p)
+{
+    if (p.size < 8 or not std::has_single_bit(p.size)) {
+        throw std::runtime_error(log_message(fmt::format(
+            "ocean size {} is not a power of two of at least 8", p.size)));
+    }
+    if (not(p.patch_length > 0.f and p.repeat_period > 0.f
+            and p.wind_speed > 0.f)) {
+        throw std::runtime_error(log_message(
+            "ocean patch length, repeat period and wind speed have to be "
+            "positive"sv));
+    }
+}
+
+// kx of column i or kz of row i, k = 0 sits at size / 2
+inline auto wave_number(uint32_t i, const parameters& p) -> float
+{
+    const auto dk = 2.f * std::numbers::pi_v<float> / p.patch_length;
+    return (static_cast<float>(i) - static_cast<float>(p.size / 2)) * dk;
+}
+
+// time wrapped into [0, repeat_period), which keeps float phases precise
+// however long the surface runs
+inline auto looped_time(double time, const parameters& p) -> double
+{
+    const auto period = static_cast<double>(p.repeat_period);
+    const auto looped = std::fmod(time, period);
+    return looped < 0. ? looped + period : looped;
+}
+
+// the random spectrum every simulation of p starts from, row major with kz
+// along rows
+struct initial_spectrum {
+    // h0(k) in xy and conj(h0(-k)) in zw
+    std::vector<glm::vec4> h0;
+    // radians per second, whole multiples of 2π / repeat_period
+    std::vector<float> omega;
+};
+
+inline auto draw_spectrum(const parameters& p) -> initial_spectrum
+{
+    validate(p);
+    const auto n     = p.size;
+    const auto dk    = 2.f * std::numbers::pi_v<float> / p.patch_length;
+    const auto count = size_t{n} * n;
+    initial_spectrum initial{.h0    = std::vector<glm::vec4>(count),
+                             .omega = std::vector<float>(count)};
+    const auto omega_step
+        = 2.f * std::numbers::pi_v<float> / p.repeat_period;
+    std::mt19937 random{p.seed};
+    std::normal_distribution<float> gaussian;
+    for (uint32_t m = 0; m < n; ++m) {
+        for (uint32_t c = 0; c < n; ++c) {
+            const auto re = gaussian(random);
+            const auto im = gaussian(random);
+            // the nyquist row and column have no mirror to pair with
+            const glm::vec2 k{wave_number(c, p), wave_number(m, p)};
+            if (m == 0 or c == 0 or (k.x == 0.f and k.y == 0.f)) {
+                continue;
+            }
+            const auto i      = size_t{m} * n + c;
+            const auto length = std::sqrt(glm::dot(k, k));
+            // the height's variance is the spectrum's integral, each ±k pair
+            // shares its part
+            const auto amplitude = std::sqrt(spectrum(k, p)) * dk / 2.f;
+            initial.h0[i] = {re * amplitude, im * amplitude, 0.f, 0.f};
+            initial.omega[i]
+                = std::floor(std::sqrt(gravity * length) / omega_step)
+                  * omega_step;
+        }
+    }
+    for (uint32_t m = 0; m < n; ++m) {
+        for (uint32_t c = 0; c < n; ++c) {
+            const auto& mirror = initial.h0[size_t{(n - m) % n} * n
+                                            + (n - c) % n];
+            auto& h0 = initial.h0[size_t{m} * n + c];
+            h0.z     = mirror.x;
+            h0.w     = -mirror.y;
+        }
+    }
+    return initial;
+}
+
+// Tessendorf's spectral ocean on the cpu: a random spectrum drawn once,
+// advanced analytically and brought to the grid by inverse ffts every frame
+//
+// displacement and slopes are packed two real fields per complex transform,
+// so three 2d ffts give the whole surface; each 1d pass runs over 8 columns
+// side by side, which fills an avx2 register without shuffles, and blocks of
+// columns are split across the scheduler
+class simulation {
+  public:
+    // columns transformed together
+    static constexpr uint32_t lanes = 8;
+
+  private:
+    // packed fields: choppy displacement, slope, height
+    static constexpr uint32_t field_count = 3;
+    // keeps the real and imaginary parts of a field off the same cache sets,
+    // power of two strides between them thrash l1 at 1024
+    static constexpr uint32_t field_padding = 16;
+
+    parameters parameters_;
+    uint32_t size_ = 0;
+    // per k, stored block by block of lanes columns in the order the column
+    // pass reads them: h0(k), conj(h0(-k)), the frequency and 1 / |k|
+    std::vector<float> h0_re_;
+    std::vector<float> h0_im_;
+    std::vector<float> mirror_re_;
+    std::vector<float> mirror_im_;
+    std::vector<float> omega_;
+    std::vector<float> inverse_k_;
+    // kx per column, kz per row
+    std::vector<float> wave_x_;
+    std::vector<float> wave_z_;
+    // e^(2πij/size) for j < size / 2
+    std::vector<float> twiddle_re_;
+    std::vector<float> twiddle_im_;
+    std::vector<uint32_t> bit_reverse_;
+    // the column pass's output laid out as the row pass's input, one block
+    // of fields per lanes rows, so the row pass transforms in place
+    std::vector<float> rows_;
+
+    auto field_stride_() const
+    {
+        return size_t{size_} * lanes + field_padding;
+    }
+
+    auto block_stride_() const { return 2 * field_count * field_stride_(); }
+
+    // 64 byte aligned start of rows_
+    auto rows_base_()
+    {
+        const auto address = reinterpret_cast<uintptr_t>(rows_.data());
+        return rows_.data() + (-address & 63) / sizeof(float);
+    }
+
+    // real parts at even fields, imaginary parts at odd ones
+    auto field_(float* block, uint32_t f) const
+    {
+        return block + f * field_stride_();
+    }
+
+    auto spectrum_index_(uint32_t row, uint32_t column) const
+    {
+        return (size_t{column} / lanes * size_ + row) * lanes + column % lanes;
+    }
+
+    inline auto create_spectrum_()
+    {
+        const auto n = size_;
+        wave_x_.resize(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            wave_x_[i] = wave_number(i, parameters_);
+        }
+        wave_z_          = wave_x_;
+        const auto count = size_t{n} * n;
+        for (auto* v : {&h0_re_, &h0_im_, &mirror_re_, &mirror_im_, &omega_,
+                        &inverse_k_}) {
+            v->resize(count);
+        }
+        const auto initial = draw_spectrum(parameters_);
+        for (uint32_t m = 0; m < n; ++m) {
+            for (uint32_t c = 0; c < n; ++c) {
+                const auto from   = size_t{m} * n + c;
+                const auto i      = spectrum_index_(m, c);
+                const auto& h0    = initial.h0[from];
+                const auto length = std::hypot(wave_x_[c], wave_z_[m]);
+                h0_re_[i]         = h0.x;
+                h0_im_[i]         = h0.y;
+                mirror_re_[i]     = h0.z;
+                mirror_im_[i]     = h0.w;
+                omega_[i]         = initial.omega[from];
+                inverse_k_[i]     = length > 0.f ? 1.f / length : 0.f;
+            }
+        }
+    }
+
+    inline auto create_fft_tables_()
+    {
+        const auto n = size_;
+        twiddle_re_.resize(n / 2);
+        twiddle_im_.resize(n / 2);
+        for (uint32_t j = 0; j < n / 2; ++j) {
+            const auto angle = 2. * std::numbers::pi * j / n;
+            twiddle_re_[j]   = static_cast<float>(std::cos(angle));
+            twiddle_im_[j]   = static_cast<float>(std::sin(angle));
+        }
+        const auto bits = std::countr_zero(n);
+        bit_reverse_.resize(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            uint32_t reversed = 0;
+            for (int b = 0; b < bits; ++b) {
+                reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+            }
+            bit_reverse_[i] = reversed;
+        }
+    }
+
+    // per thread, every column block reuses it
+    inline auto scratch_() const
+    {
+        static thread_local std::vector<float> scratch;
+        scratch.resize(block_stride_());
+        return scratch.data();
+    }
+
+    // h(k, t) and the fields derived from it for columns [column, column +
+    // lanes)
+    inline auto load_spectrum_scalar_(uint32_t column,
+                                      float time,
+                                      float* scratch) const
+    {
+        const auto n = size_;
+        for (uint32_t m = 0; m < n; ++m) {
+            const auto kz    = wave_z_[m];
+            const auto first = spectrum_index_(m, column);
+            const auto at    = size_t{m} * lanes;
+            for (uint32_t l = 0; l < lanes; ++l) {
+                const auto i     = first + l;
+                const auto phase = omega_[i] * time;
+                const auto c     = std::cos(phase);
+                const auto s     = std::sin(phase);
+                const auto hr    = (h0_re_[i] + mirror_re_[i]) * c
+                                + (mirror_im_[i] - h0_im_[i]) * s;
+                const auto hi = (h0_im_[i] + mirror_im_[i]) * c
+                                + (h0_re_[i] - mirror_re_[i]) * s;
+                const auto kx = wave_x_[column + l];
+                const auto ux = kx * inverse_k_[i];
+                const auto uz = kz * inverse_k_[i];
+                // i k̂ h in x plus i times the same in z, then i k h likewise
+                field_(scratch, 0)[at + l] = -ux * hi - uz * hr;
+                field_(scratch, 1)[at + l] = ux * hr - uz * hi;
+                field_(scratch, 2)[at + l] = -kx * hi - kz * hr;
+                field_(scratch, 3)[at + l] = kx * hr - kz * hi;
+                field_(scratch, 4)[at + l] = hr;
+                field_(scratch, 5)[at + l] = hi;
+            }
+        }
+    }
+
+    // radix 2 decimation in frequency, lane by lane; natural order in,
+    // bit reversed order out, so neither pass permutes its input
+    inline auto inverse_fft_scalar_(float* re, float* im) const
+    {
+        const auto n = size_;
+        for (auto half = n / 2; half > 0; half /= 2) {
+            const auto step = n / (2 * half);
+            for (uint32_t start = 0; start < n; start += 2 * half) {
+                for (uint32_t j = 0; j < half; ++j) {
+                    const auto wr = twiddle_re_[j * step];
+                    const auto wi = twiddle_im_[j * step];
+                    auto* ar      = re + size_t{start + j} * lanes;
+                    auto* ai      = im + size_t{start + j} * lanes;
+                    auto* br      = ar + size_t{half} * lanes;
+                    auto* bi      = ai + size_t{half} * lanes;
+                    for (uint32_t l = 0; l < lanes; ++l) {
+                        const auto dr = ar[l] - br[l];
+                        const auto di = ai[l] - bi[l];
+                        ar[l] += br[l];
+                        ai[l] += bi[l];
+                        br[l] = dr * wr - di * wi;
+                        bi[l] = dr * wi + di * wr;
+                    }
+                }
+            }
+        }
+    }
+
+#if ANTARTAR_SIMD_X86
+    // Cephes' single precision polynomials, the argument reduced to ±π/4
+    // around the nearest multiple of π/2 picks polynomial and sign per lane
+    ANTARTAR_TARGET_AVX2 static inline auto
+    sincos_avx2_(__m256 x, __m256& sine, __m256& cosine)
+    {
+        const auto sign_mask = _mm256_set1_ps(-0.f);
+        auto sine_sign       = _mm256_and_ps(x, sign_mask);
+        x                    = _mm256_andnot_ps(sign_mask, x);
+        auto octant          = _mm256_cvttps_epi32(_mm256_mul_ps(
+            x, _mm256_set1_ps(4.f / std::numbers::pi_v<float>)));
+        octant
+            = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)),
+                               _mm256_set1_epi32(~1));
+        const auto y = _mm256_cvtepi32_ps(octant);
+        sine_sign    = _mm256_xor_ps(
+            sine_sign,
+            _mm256_castsi256_ps(_mm256_slli_epi32(
+                _mm256_and_si256(octant, _mm256_set1_epi32(4)), 29)));
+        const auto cosine_sign = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)),
+                                _mm256_set1_epi32(4)),
+            29));
+        const auto sine_polynomial = _mm256_castsi256_ps(
+            _mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)),
+                               _mm256_setzero_si256()));
+        // π/4 in three parts so the reduction stays exact
+        x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(0.78515625f)));
+        x = _mm256_sub_ps(
+            x, _mm256_mul_ps(y, _mm256_set1_ps(2.4187564849853515625e-4f)));
+        x = _mm256_sub_ps(
+            x, _mm256_mul_ps(y, _mm256_set1_ps(3.77489497744594108e-8f)));
+        const auto z = _mm256_mul_ps(x, x);
+        auto c       = _mm256_set1_ps(2.443315711809948e-5f);
+        c            = _mm256_add_ps(_mm256_mul_ps(c, z),
+                          _mm256_set1_ps(-1.388731625493765e-3f));
+        c            = _mm256_add_ps(_mm256_mul_ps(c, z),
+                          _mm256_set1_ps(4.166664568298827e-2f));
+        c            = _mm256_mul_ps(_mm256_mul_ps(c, z), z);
+        c = _mm256_sub_ps(c, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+        c = _mm256_add_ps(c, _mm256_set1_ps(1.f));
+        auto s = _mm256_set1_ps(-1.9515295891e-4f);
+        s      = _mm256_add_ps(_mm256_mul_ps(s, z),
+                          _mm256_set1_ps(8.3321608736e-3f));
+        s      = _mm256_add_ps(_mm256_mul_ps(s, z),
+                          _mm256_set1_ps(-1.6666654611e-1f));
+        s      = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), x), x);
+        sine   = _mm256_xor_ps(_mm256_blendv_ps(c, s, sine_polynomial),
+                             sine_sign);
+        cosine = _mm256_xor_ps(_mm256_blendv_ps(s, c, sine_polynomial),
+                               cosine_sign);
+    }
+
+    ANTARTAR_TARGET_AVX2 inline auto
+    load_spectrum_avx2_(uint32_t column, float time, float* scratch) const
+    {
+        const auto n    = size_;
+        const auto t    = _mm256_set1_ps(time);
+        const auto kx   = _mm256_loadu_ps(wave_x_.data() + column);
+        const auto zero = _mm256_setzero_ps();
+        for (uint32_t m = 0; m < n; ++m) {
+            const auto kz = _mm256_set1_ps(wave_z_[m]);
+            const auto i  = spectrum_index_(m, column);
+            const auto at = size_t{m} * lanes;
+            __m256 s;
+            __m256 c;
+            sincos_avx2_(_mm256_mul_ps(_mm256_loadu_ps(omega_.data() + i), t),
+                         s,
+                         c);
+            const auto h0r = _mm256_loadu_ps(h0_re_.data() + i);
+            const auto h0i = _mm256_loadu_ps(h0_im_.data() + i);
+            const auto mr  = _mm256_loadu_ps(mirror_re_.data() + i);
+            const auto mi  = _mm256_loadu_ps(mirror_im_.data() + i);
+            const auto hr
+                = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(h0r, mr), c),
+                                _mm256_mul_ps(_mm256_sub_ps(mi, h0i), s));
+            const auto hi
+                = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(h0i, mi), c),
+                                _mm256_mul_ps(_mm256_sub_ps(h0r, mr), s));
+            const auto inverse_k = _mm256_loadu_ps(inverse_k_.data() + i);
+            const auto ux        = _mm256_mul_ps(kx, inverse_k);
+            const auto uz        = _mm256_mul_ps(kz, inverse_k);
+            _mm256_storeu_ps(
+                field_(scratch, 0) + at,
+                _mm256_sub_ps(_mm256_sub_ps(zero, _mm256_mul_ps(ux, hi)),
+                              _mm256_mul_ps(uz, hr)));
+            _mm256_storeu_ps(field_(scratch, 1) + at,
+                             _mm256_sub_ps(_mm256_mul_ps(ux, hr),
+                                           _mm256_mul_ps(uz, hi)));
+            _mm256_storeu_ps(
+                field_(scratch, 2) + at,
+                _mm256_sub_ps(_mm256_sub_ps(zero, _mm256_mul_ps(kx, hi)),
+                              _mm256_mul_ps(kz, hr)));
+            _mm256_storeu_ps(field_(scratch, 3) + at,
+                             _mm256_sub_ps(_mm256_mul_ps(kx, hr),
+                                           _mm256_mul_ps(kz, hi)));
+            _mm256_storeu_ps(field_(scratch, 4) + at, hr);
+            _mm256_storeu_ps(field_(scratch, 5) + at, hi);
+        }
+    }
+
+    ANTARTAR_TARGET_AVX2 inline auto inverse_fft_avx2_(float* re,
+                                                       float* im) const
+    {
+        const auto n = size_;
+        for (auto half = n / 2; half > 0; half /= 2) {
+            const auto step = n / (2 * half);
+            for (uint32_t start = 0; start < n; start += 2 * half) {
+                for (uint32_t j = 0; j < half; ++j) {
+                    const auto wr = _mm256_set1_ps(twiddle_re_[j * step]);
+                    const auto wi = _mm256_set1_ps(twiddle_im_[j * step]);
+                    auto* ar      = re + size_t{start + j} * lanes;
+                    auto* ai      = im + size_t{start + j} * lanes;
+                    auto* br      = ar + size_t{half} * lanes;
+                    auto* bi      = ai + size_t{half} * lanes;
+                    const auto xr = _mm256_loadu_ps(ar);
+                    const auto xi = _mm256_loadu_ps(ai);
+                    const auto yr = _mm256_loadu_ps(br);
+                    const auto yi = _mm256_loadu_ps(bi);
+                    const auto dr = _mm256_sub_ps(xr, yr);
+                    const auto di = _mm256_sub_ps(xi, yi);
+                    _mm256_storeu_ps(ar, _mm256_add_ps(xr, yr));
+                    _mm256_storeu_ps(ai, _mm256_add_ps(xi, yi));
+                    _mm256_storeu_ps(br,
+                                     _mm256_sub_ps(_mm256_mul_ps(dr, wr),
+                                                   _mm256_mul_ps(di, wi)));
+                    _mm256_storeu_ps(bi,
+                                     _mm256_add_ps(_mm256_mul_ps(dr, wi),
+                                                   _mm256_mul_ps(di, wr)));
+                }
+            }
+        }
+    }
+
+    // tiles transposed in registers and streamed past the caches, the rows
+    // outgrow them at 512 and skipping the read for ownership halves the
+    // traffic
+    ANTARTAR_TARGET_AVX2 inline auto store_columns_avx2_(uint32_t column,
+                                                         float* scratch)
+    {
+        const auto n = size_;
+        for (uint32_t f = 0; f < 2 * field_count; ++f) {
+            const auto* source = field_(scratch, f);
+            for (uint32_t row = 0; row < n; row += lanes) {
+                auto* block  = rows_base_() + row / lanes * block_stride_();
+                auto* target = field_(block, f) + size_t{column} * lanes;
+                __m256 r[lanes];
+                for (uint32_t j = 0; j < lanes; ++j) {
+                    r[j] = _mm256_loadu_ps(
+                        source + size_t{bit_reverse_[row + j]} * lanes);
+                }
+                __m256 t[lanes];
+                for (uint32_t j = 0; j < lanes; j += 2) {
+                    t[j]     = _mm256_unpacklo_ps(r[j], r[j + 1]);
+                    t[j + 1] = _mm256_unpackhi_ps(r[j], r[j + 1]);
+                }
+                for (uint32_t j = 0; j < lanes; j += 4) {
+                    r[j]     = _mm256_shuffle_ps(t[j], t[j + 2], 0x44);
+                    r[j + 1] = _mm256_shuffle_ps(t[j], t[j + 2], 0xee);
+                    r[j + 2] = _mm256_shuffle_ps(t[j + 1], t[j + 3], 0x44);
+                    r[j + 3] = _mm256_shuffle_ps(t[j + 1], t[j + 3], 0xee);
+                }
+                for (uint32_t j = 0; j < 4; ++j) {
+                    _mm256_stream_ps(
+                        target + size_t{j} * lanes,
+                        _mm256_permute2f128_ps(r[j], r[j + 4], 0x20));
+                    _mm256_stream_ps(
+                        target + size_t{j + 4} * lanes,
+                        _mm256_permute2f128_ps(r[j], r[j + 4], 0x31));
+                }
+            }
+        }
+        _mm_sfence();
+    }
+#endif
+
+    inline auto inverse_ffts_(float* block, bool avx2) const
+    {
+        for (uint32_t f = 0; f < 2 * field_count; f += 2) {
+            auto* re = field_(block, f);
+            auto* im = field_(block, f + 1);
+#if ANTARTAR_SIMD_X86
+            if (avx2) {
+                inverse_fft_avx2_(re, im);
+                continue;
+            }
+#endif
+            inverse_fft_scalar_(re, im);
+        }
+    }
+
+    // 8 by 8 tiles of the column block move to the row blocks, the ffts
+    // left the rows in bit reversed order
+    inline auto store_columns_(uint32_t column, float* scratch)
+    {
+        const auto n = size_;
+        for (uint32_t f = 0; f < 2 * field_count; ++f) {
+            const auto* source = field_(scratch, f);
+            for (uint32_t row = 0; row < n; row += lanes) {
+                auto* block  = rows_base_() + row / lanes * block_stride_();
+                auto* target = field_(block, f) + size_t{column} * lanes;
+                for (uint32_t j = 0; j < lanes; ++j) {
+                    const auto* from
+                        = source + size_t{bit_reverse_[row + j]} * lanes;
+                    for (uint32_t l = 0; l < lanes; ++l) {
+                        target[l * lanes + j] = from[l];
+                    }
+                }
+            }
+        }
+    }
+
+    // rows [row, row + lanes) of the surface, the spectrum being centered
+    // on k = 0 flips the sign of every other sample
+    inline auto
+    store_samples_(uint32_t row, float* block, std::span<sample> out) const
+    {
+        const auto n      = size_;
+        const auto lambda = parameters_.choppiness;
+        const auto* dx    = field_(block, 0);
+        const auto* dz    = field_(block, 1);
+        const auto* sx    = field_(block, 2);
+        const auto* sz    = field_(block, 3);
+        const auto* h     = field_(block, 4);
+        for (uint32_t l = 0; l < lanes; ++l) {
+            const auto z = row + l;
+            auto* target = out.data() + size_t{z} * n;
+            for (uint32_t x = 0; x < n; ++x) {
+                const auto sign = ((x + z) & 1u) != 0 ? -1.f : 1.f;
+                const auto i    = size_t{bit_reverse_[x]} * lanes + l;
+                target[x]       = {
+                          .displacement = {sign * lambda * dx[i],
+                                           sign * h[i],
+                                           sign * lambda * dz[i]},
+                          .slope        = {sign * sx[i], sign * sz[i]}
+                };
+            }
+        }
+    }
+
+  public:
+    inline explicit simulation(const parameters& p)
+        : parameters_{p}, size_{p.size}
+    {
+        validate(p);
+        create_spectrum_();
+        create_fft_tables_();
+        rows_.resize(size_ / lanes * block_stride_() + 16);
+    }
+
+    auto size() const { return size_; }
+    auto patch_length() const { return parameters_.patch_length; }
+    auto sample_count() const { return size_t{size_} * size_; }
+
+    // the surface time seconds in, sample_count samples row by row with rows
+    // along z; out may be mapped device memory, it is written once in order
+    inline auto simulate(double time,
+                         std::span<sample> out,
+                         jobs::scheduler& workers,
+                         simd_level level = supported_simd_level())
+    {
+        if (out.size() < sample_count()) {
+            throw std::runtime_error(log_message(fmt::format(
+                "ocean needs {} samples, got {}", sample_count(), out.size())));
+        }
+        const auto t      = static_cast<float>(looped_time(time, parameters_));
+        const auto avx2   = usable_simd_level(level) == simd_level::avx2;
+        const auto blocks = size_ / lanes;
+        workers.parallel_for(blocks, 1, [&](size_t first, size_t last) {
+            auto* scratch = scratch_();
+            for (auto block = first; block < last; ++block) {
+                const auto column = static_cast<uint32_t>(block) * lanes;
+#if ANTARTAR_SIMD_X86
+                if (avx2) {
+                    load_spectrum_avx2_(column, t, scratch);
+                }
+                else {
+                    load_spectrum_scalar_(column, t, scratch);
+                }
+#else
+                load_spectrum_scalar_(column, t, scratch);
+#endif
+                inverse_ffts_(scratch, avx2);
+#if ANTARTAR_SIMD_X86
+                if (avx2) {
+                    store_columns_avx2_(column, scratch);
+                    continue;
+                }
+#endif
+                store_columns_(column, scratch);
+            }
+        });
+        workers.parallel_for(blocks, 1, [&](size_t first, size_t last) {
+            for (auto block = first; block < last; ++block) {
+                auto* rows = rows_base_() + block * block_stride_();
+                inverse_ffts_(rows, avx2);
+                store_samples_(static_cast<uint32_t>(block) * lanes, rows, out);
+            }
+        });
+    }
+};
+} // namespace antartar::ocean
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <antartar/log.hpp>
+#include <antartar/pacing.hpp>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <fmt/format.h>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace antartar {
+struct options {
+    bool headless = false;
+    // headless frames read back and hashed
+    bool readback = false;
+    // 0 runs until the window is closed, headless runs need a limit
+    uint64_t frames = 0;
+    uint32_t width  = 800;
+    uint32_t height = 600;
+    // frames are timed and summarized instead of rendered endlessly, frames
+    // is then the number of measured frames
+    bool benchmark  = false;
+    uint64_t warmup = 100;
+    // benchmark json goes to stdout when empty
+    std::string output;
+    // chrome trace of the profiling zones, not written when empty
+    std::string trace;
+    // times the job system alone on 1 to all cores, frames is the number of
+    // measured runs per worker count
+    bool jobs_benchmark = false;
+    // times frustum culling of random bounds at every simd level the cpu
+    // has, on the calling thread, frames is the number of measured runs
+    bool culling_benchmark = false;
+    // times the cpu ocean at 256, 512 and 1024 samples per side and every
+    // simd level the cpu has, frames is the number of measured frames
+    bool ocean_benchmark = false;
+    // times the mesh optimizer's steps on a row order grid and a shuffled
+    // sphere and reports their vertex cache and fetch stats before and
+    // after, frames is the number of measured runs
+    bool mesh_benchmark = false;
+    // draws a tiles x tiles grid of quads instead of a single one
+    uint32_t tiles = 0;
+    // copies of the grid stacked behind the first one
+    uint32_t layers = 1;
+    // --no-instancing draws every tile with its own call
+    bool instancing = true;
+    // --direct records every draw on the cpu instead of letting a compute
+    // pass write indirect commands
+    bool indirect = true;
+    // --no-occlusion keeps indirect draws hidden behind the previous frame
+    bool occlusion = true;
+    // samples per side of an ocean simulated on the cpu every frame, 0 runs
+    // none
+    uint32_t cpu_ocean = 0;
+    // samples per side of an ocean simulated on the device every frame and
+    // drawn instead of the quads, 0 runs none
+    uint32_t gpu_ocean = 0;
+    // headless runs compare one frame of the gpu ocean against the cpu
+    // simulation and fail past tolerance
+    bool check_ocean = false;
+    // windowed benchmarks resize the window every N frames, 0 never does
+    uint64_t resize_storm = 0;
+    // --latency picks the policy, --frames-in-flight and --present-mode
+    // override parts of it
+    vk::frame_pacing pacing;
+};
+
+namespace detail {
+template<typename T>
+inline auto parse_number(std::string_view name, std::string_view value)
+{
+    T result{};
+    auto [ptr, ec] =
+        std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc{} or ptr != value.data() + value.size()) {
+        throw std::runtime_error(log_message(
+            fmt::format("invalid value '{}' for option {}", value, name)));
+    }
+    return result;
+}
+} // namespace detail
+
+// --headless --readback --frames=N --width=N --height=N
+// --benchmark --warmup=N --output=path --trace=path --jobs-benchmark
+// --culling-benchmark --ocean-benchmark --mesh-benchmark
+// --resize-storm=N --tiles=N --layers=N --no-instancing --direct
+// --no-occlusion --cpu-ocean=N --gpu-ocean=N --check-ocean
+// --latency=low|balanced|throughput --frames-in-flight=N
+// --present-mode=immediate|mailbox|fifo|fifo_relaxed
+inline auto parse_options(std::span<const char* const> args) -> options
+{
+    options result;
+    std::optional<uint32_t> frames_in_flight;
+    std::optional<VkPresentModeKHR> present_mode;
+    // args[0] is the program name
+    for (std::string_view arg :
+         args.subspan(std::min<size_t>(1, args.size()))) {
+        const auto separator = arg.find('=');
+        const auto name      = arg.substr(0, separator);
+        const auto value     = separator == std::string_view::npos
+                                   ? std::string_view{}
+                                   : arg.substr(separator + 1);
+        if (name == "--headless") {
+            result.headless = true;
+        }
+        else if (name == "--readback") {
+            result.readback = true;
+        }
+        else if (name == "--frames") {
+            result.frames = detail::parse_number<uint64_t>(name, value);
+        }
+        else if (name == "--width") {
+            result.width = detail::parse_number<uint32_t>(name, value);
+        }
+        else if (name == "--height") {
+            result.height = detail::parse_number<uint32_t>(name, value);
+        }
+        else if (name == "--benchmark") {
+            result.benchmark = true;
+        }
+        else if (name == "--warmup") {
+            result.warmup = detail::parse_number<uint64_t>(name, value);
+        }
+        else if (name == "--output") {
+            result.output = value;
+        }
+        else if (name == "--trace") {
+            result.trace = value;
+        }
+        else if (name == "--jobs-benchmark") {
+            result.jobs_benchmark = true;
+        }
+        else if (name == "--culling-benchmark") {
+            result.culling_benchmark = true;
+        }
+        else if (name == "--ocean-benchmark") {
+            result.ocean_benchmark = true;
+        }
+        else if (name == "--mesh-benchmark") {
+            result.mesh_benchmark = true;
+        }
+        else if (name == "--tiles") {
+            result.tiles = detail::parse_number<uint32_t>(name, value);
+        }
+        else if (name == "--layers") {
+            result.layers = detail::parse_number<uint32_t>(name, value);
+            if (result.layers == 0) {
+                throw std::runtime_error(
+                    log_message(fmt::format("{} has to be at least 1", name)));
+            }
+        }
+        else if (name == "--no-instancing") {
+            result.instancing = false;
+        }
+        else if (name == "--direct") {
+            result.indirect = false;
+        }
+        else if (name == "--no-occlusion") {
+            result.occlusion = false;
+        }
+        else if (name == "--cpu-ocean" or name == "--gpu-ocean") {
+            const auto size = detail::parse_number<uint32_t>(name, value);
+            if (size < 8 or not std::has_single_bit(size)) {
+                throw std::runtime_error(log_message(fmt::format(
+                    "{} has to be a power of two of at least 8", name)));
+            }
+            (name == "--cpu-ocean" ? result.cpu_ocean : result.gpu_ocean) =
+                size;
+        }
+        else if (name == "--check-ocean") {
+            result.check_ocean = true;
+        }
+        else if (name == "--resize-storm") {
+            result.resize_storm = detail::parse_number<uint64_t>(name, value);
+        }
+        else if (name == "--latency") {
+            result.pacing =
+                vk::make_frame_pacing(vk::parse_latency_mode(name, value));
+        }
+        else if (name == "--frames-in-flight") {
+            frames_in_flight = detail::parse_number<uint32_t>(name, value);
+            if (*frames_in_flight == 0
+                or *frames_in_flight > vk::max_frames_in_flight) {
+                throw std::runtime_error(log_message(
+                    fmt::format("{} has to be between 1 and {}",
+                                name,
+                                vk::max_frames_in_flight)));
+            }
+        }
+        else if (name == "--present-mode") {
+            present_mode = vk::parse_present_mode(name, value);
+        }
+        else {
+            throw std::runtime_error(
+                log_message(fmt::format("unknown option {}", arg)));
+        }
+    }
+    // overrides apply whatever the order on the command line
+    if (frames_in_flight) {
+        result.pacing.frames_in_flight = *frames_in_flight;
+    }
+    if (present_mode) {
+        result.pacing.present_modes.fill(*present_mode);
+    }
+    if (result.check_ocean
+        and (not result.headless or result.gpu_ocean == 0)) {
+        throw std::runtime_error(log_message(
+            "--check-ocean needs --headless and --gpu-ocean"sv));
+    }
+    if ((result.jobs_benchmark or result.culling_benchmark
+         or result.ocean_benchmark or result.mesh_benchmark)
+        and result.frames == 0) {
+        result.frames = 200;
+    }
+    if ((result.headless or result.benchmark) and result.frames == 0) {
+        result.frames = 1000;
+    }
+    return result;
+}
+} // namespace antartar
@@ -0,0 +1,129 @@
+#pragma once
+#include <antartar/log.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fmt/format.h>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// upper bound of frame_pacing::frames_in_flight, sizes per frame arrays
+constexpr uint32_t max_frames_in_flight = 3;
+
+enum class latency_mode { balanced, low_latency, max_throughput };
+
+// how far the cpu may run ahead of the display
+struct frame_pacing {
+    latency_mode mode = latency_mode::balanced;
+    // frames recorded or executing while the cpu starts on the next one
+    uint32_t frames_in_flight = 2;
+    // swap chain images on top of the surface's minImageCount
+    uint32_t extra_images = 1;
+    // the first one the surface supports wins, fifo is always supported
+    std::array<VkPresentModeKHR, 3> present_modes = {
+        VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_FIFO_KHR,
+        VK_PRESENT_MODE_FIFO_KHR};
+    // block after presenting until the oldest frame in flight is on screen,
+    // needs VK_KHR_present_wait; latency is measured whenever it's supported
+    bool wait_for_present = false;
+};
+
+inline auto make_frame_pacing(latency_mode mode) -> frame_pacing
+{
+    switch (mode) {
+    case latency_mode::low_latency:
+        // input is polled right after the previous frame hit the screen and
+        // mailbox replaces a queued frame instead of piling up behind it
+        return {.mode             = mode,
+                .frames_in_flight = 1,
+                .extra_images     = 1,
+                .present_modes    = {VK_PRESENT_MODE_MAILBOX_KHR,
+                                     VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                     VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+                .wait_for_present = true};
+    case latency_mode::max_throughput:
+        // never blocks on the display and keeps the gpu fed
+        return {.mode             = mode,
+                .frames_in_flight = max_frames_in_flight,
+                .extra_images     = 2,
+                .present_modes    = {VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                     VK_PRESENT_MODE_MAILBOX_KHR,
+                                     VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+                .wait_for_present = false};
+    case latency_mode::balanced:
+        break;
+    }
+    return {};
+}
+
+inline auto choose_present_mode(const frame_pacing& pacing,
+                                std::span<const VkPresentModeKHR> available)
+{
+    for (auto mode : pacing.present_modes) {
+        if (std::ranges::find(available, mode) != std::end(available)) {
+            return mode;
+        }
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+namespace detail {
+constexpr std::array latency_mode_names = {
+    std::pair{latency_mode::balanced,       "balanced"sv  },
+    std::pair{latency_mode::low_latency,    "low"sv       },
+    std::pair{latency_mode::max_throughput, "throughput"sv},
+};
+
+constexpr std::array present_mode_names = {
+    std::pair{VK_PRESENT_MODE_IMMEDIATE_KHR,    "immediate"sv   },
+    std::pair{VK_PRESENT_MODE_MAILBOX_KHR,      "mailbox"sv     },
+    std::pair{VK_PRESENT_MODE_FIFO_KHR,         "fifo"sv        },
+    std::pair{VK_PRESENT_MODE_FIFO_RELAXED_KHR, "fifo_relaxed"sv},
+};
+
+inline auto find_name(const auto& names, auto value) -> std::string_view
+{
+    auto it = std::ranges::find_if(
+        names, [&](const auto& entry) { return entry.first == value; });
+    return it == std::end(names) ? "unknown"sv : it->second;
+}
+
+inline auto find_value(const auto& names,
+                       std::string_view option,
+                       std::string_view name)
+{
+    auto it = std::ranges::find_if(
+        names, [&](const auto& entry) { return entry.second == name; });
+    if (it == std::end(names)) {
+        throw std::runtime_error(log_message(
+            fmt::format("invalid value '{}' for option {}", name, option)));
+    }
+    return it->first;
+}
+} // namespace detail
+
+inline auto latency_mode_name(latency_mode mode)
+{
+    return detail::find_name(detail::latency_mode_names, mode);
+}
+
+inline auto present_mode_name(VkPresentModeKHR mode)
+{
+    return detail::find_name(detail::present_mode_names, mode);
+}
+
+inline auto parse_latency_mode(std::string_view option, std::string_view name)
+{
+    return detail::find_value(detail::latency_mode_names, option, name);
+}
+
+inline auto parse_present_mode(std::string_view option, std::string_view name)
+{
+    return detail::find_value(detail::present_mode_names, option, name);
+}
+} // namespace antartar::vk
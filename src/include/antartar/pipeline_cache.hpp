@@ -0,0 +1,135 @@
+#pragma once
+#include <antartar/file.hpp>
+#include <antartar/log.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// VkPipelineCache backed by a file, the blob is prefixed with the identity of
+// the device and driver that produced it so a driver update or a different gpu
+// starts from an empty cache instead of feeding the driver foreign data
+class pipeline_cache {
+  private:
+    struct file_header {
+        std::array<char, 8> magic;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint32_t data_size;
+        std::array<uint8_t, VK_UUID_SIZE> pipeline_cache_uuid;
+    };
+    static constexpr std::array<char, 8> magic = {
+        'a', 'n', 't', 'p', 'c', 'a', 'c', '1'};
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties_;
+    std::filesystem::path path_;
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    bool warm_             = false;
+
+    inline auto make_header_(uint32_t data_size) const
+    {
+        file_header header{.magic          = magic,
+                           .vendor_id      = properties_.vendorID,
+                           .device_id      = properties_.deviceID,
+                           .driver_version = properties_.driverVersion,
+                           .data_size      = data_size};
+        std::ranges::copy(properties_.pipelineCacheUUID,
+                          std::begin(header.pipeline_cache_uuid));
+        return header;
+    }
+
+    // returns the driver blob stored in the file, empty when the file is
+    // missing or was written by another device or driver
+    inline auto load_() const -> std::vector<std::byte>
+    {
+        auto content = file::read(path_);
+        if (not content or content->size() < sizeof(file_header)) {
+            return {};
+        }
+        file_header stored;
+        std::memcpy(std::addressof(stored), content->data(), sizeof(stored));
+        const auto expected = make_header_(stored.data_size);
+        if (std::memcmp(std::addressof(stored),
+                        std::addressof(expected),
+                        sizeof(file_header))
+                != 0
+            or content->size() - sizeof(file_header) != stored.data_size) {
+            log("discarding stale pipeline cache {}", path_.string());
+            return {};
+        }
+        return {std::next(std::begin(*content), sizeof(file_header)),
+                std::end(*content)};
+    }
+
+  public:
+    inline pipeline_cache(VkPhysicalDevice physical_device,
+                          VkDevice device,
+                          std::filesystem::path path)
+        : device_{device}, path_{std::move(path)}
+    {
+        vkGetPhysicalDeviceProperties(physical_device,
+                                      std::addressof(properties_));
+        const auto initial_data = load_();
+        warm_                   = not initial_data.empty();
+
+        VkPipelineCacheCreateInfo create_info{
+            .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .initialDataSize = initial_data.size(),
+            .pInitialData    = initial_data.data()};
+        if (VK_SUCCESS
+            != vkCreatePipelineCache(device_,
+                                     std::addressof(create_info),
+                                     nullptr,
+                                     std::addressof(cache_))) {
+            throw std::runtime_error(
+                log_message("failed to create pipeline cache!"sv));
+        }
+    }
+
+    pipeline_cache(const pipeline_cache&)            = delete;
+    pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+    inline ~pipeline_cache()
+    {
+        save();
+        vkDestroyPipelineCache(device_, cache_, nullptr);
+    }
+
+    inline auto save() const -> void
+    {
+        size_t data_size = 0;
+        if (VK_SUCCESS
+            != vkGetPipelineCacheData(
+                device_, cache_, std::addressof(data_size), nullptr)) {
+            return;
+        }
+        std::vector<std::byte> content(sizeof(file_header) + data_size);
+        if (VK_SUCCESS
+            != vkGetPipelineCacheData(device_,
+                                      cache_,
+                                      std::addressof(data_size),
+                                      content.data() + sizeof(file_header))) {
+            return;
+        }
+        content.resize(sizeof(file_header) + data_size);
+        const auto header = make_header_(static_cast<uint32_t>(data_size));
+        std::memcpy(content.data(), std::addressof(header), sizeof(header));
+        if (file::write(path_, content) != file::status::ok) {
+            log<severity::warning>("failed to write pipeline cache {}",
+                                   path_.string());
+        }
+    }
+
+    auto handle() const { return cache_; }
+
+    // whether the cache started from data of a previous run
+    auto warm() const { return warm_; }
+};
+} // namespace antartar::vk
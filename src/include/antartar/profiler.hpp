@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifndef ANTARTAR_PROFILING
+#define ANTARTAR_PROFILING 1
+#endif
+
+namespace antartar::profiler {
+using clock = std::chrono::steady_clock;
+
+struct zone_event {
+    const char* name;
+    clock::time_point begin;
+    clock::time_point end;
+};
+
+// written by its owning thread only, the exporter reads the first
+// published_ events; once full, further zones are dropped and counted
+class thread_buffer {
+  public:
+    static constexpr size_t capacity = 1 << 16;
+
+  private:
+    std::unique_ptr<zone_event[]> events_{new zone_event[capacity]};
+    std::atomic<size_t> published_{0};
+    std::atomic<size_t> dropped_{0};
+    uint32_t thread_id_;
+
+  public:
+    thread_buffer* next = nullptr;
+
+    inline thread_buffer(uint32_t thread_id) : thread_id_{thread_id} {}
+
+    inline auto push(const zone_event& event)
+    {
+        const auto count = published_.load(std::memory_order_relaxed);
+        if (count == capacity) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events_[count] = event;
+        published_.store(count + 1, std::memory_order_release);
+    }
+
+    inline auto for_each(auto&& callback) const
+    {
+        const auto count = published_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            callback(events_[i]);
+        }
+    }
+
+    auto thread_id() const { return thread_id_; }
+
+    auto dropped() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+// buffers are pushed onto a lock-free list once per thread and kept until
+// exit, so zones of finished threads still get exported
+class registry {
+  private:
+    std::atomic<thread_buffer*> head_{nullptr};
+    std::atomic<uint32_t> next_thread_id_{0};
+    clock::time_point epoch_ = clock::now();
+
+  public:
+    inline ~registry()
+    {
+        auto buffer = head_.load();
+        while (buffer != nullptr) {
+            delete std::exchange(buffer, buffer->next);
+        }
+    }
+
+    inline auto register_thread() -> thread_buffer&
+    {
+        auto buffer  = new thread_buffer{next_thread_id_.fetch_add(1)};
+        buffer->next = head_.load(std::memory_order_relaxed);
+        while (not head_.compare_exchange_weak(buffer->next,
+                                               buffer,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+        return *buffer;
+    }
+
+    inline auto for_each_buffer(auto&& callback) const
+    {
+        for (auto buffer = head_.load(std::memory_order_acquire);
+             buffer != nullptr;
+             buffer = buffer->next) {
+            callback(*buffer);
+        }
+    }
+
+    auto epoch() const { return epoch_; }
+};
+
+inline auto global_registry() -> registry&
+{
+    static registry instance;
+    return instance;
+}
+
+inline auto local_buffer() -> thread_buffer&
+{
+    thread_local thread_buffer& buffer = global_registry().register_thread();
+    return buffer;
+}
+
+class scoped_zone {
+  private:
+    // fetched first so the registry epoch never postdates begin_
+    thread_buffer& buffer_;
+    const char* name_;
+    clock::time_point begin_;
+
+  public:
+    // name has to be a string literal or otherwise outlive the export
+    inline explicit scoped_zone(const char* name)
+        : buffer_{local_buffer()}, name_{name}, begin_{clock::now()}
+    {
+    }
+
+    scoped_zone(const scoped_zone&)            = delete;
+    scoped_zone& operator=(const scoped_zone&) = delete;
+
+    inline ~scoped_zone()
+    {
+        buffer_.push({.name = name_, .begin = begin_, .end = clock::now()});
+    }
+};
+
+// complete ("X") events of every thread, loadable in chrome://tracing and
+// perfetto; zone names are expected not to need json escaping
+inline auto chrome_trace() -> std::string
+{
+    using microseconds = std::chrono::duration<double, std::micro>;
+    const auto& zones  = global_registry();
+    std::string json   = "{\"traceEvents\": [";
+    auto first         = true;
+    size_t dropped     = 0;
+    zones.for_each_buffer([&](const thread_buffer& buffer) {
+        dropped += buffer.dropped();
+        buffer.for_each([&](const zone_event& event) {
+            json += fmt::format(
+                "{}\n{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 0, "
+                "\"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}}}",
+                first ? "" : ",",
+                event.name,
+                buffer.thread_id(),
+                microseconds{event.begin - zones.epoch()}.count(),
+                microseconds{event.end - event.begin}.count());
+            first = false;
+        });
+    });
+    json += fmt::format("\n], \"otherData\": {{\"dropped_zones\": {}}}}}\n",
+                        dropped);
+    return json;
+}
+} // namespace antartar::profiler
+
+#define ANTARTAR_PROFILE_CONCAT_(a, b) a##b
+#define ANTARTAR_PROFILE_CONCAT(a, b)  ANTARTAR_PROFILE_CONCAT_(a, b)
+
+#if ANTARTAR_PROFILING
+#define ANTARTAR_PROFILE_ZONE(name)                                            \
+    ::antartar::profiler::scoped_zone ANTARTAR_PROFILE_CONCAT(                 \
+        antartar_profile_zone_, __LINE__)(name)
+#else
+#define ANTARTAR_PROFILE_ZONE(name)
+#endif
@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace antartar::quadtree {
+// continuous distance dependent level of detail after Strugar's CDLOD: the
+// ground plane is a quadtree whose every node is drawn with the same grid
+// of quads, level l nodes are 2^l leaves wide, and a node is split while
+// its children fall within their level's range of the eye
+//
+// vertices of level l morph onto level l + 1's grid between
+// morph_start(l) and range(l), so by the time the parent takes over the
+// child already looks like it; no seams, no popping, and the vertex count
+// depends on the levels, not on how far the plane reaches
+struct settings {
+    // quads per node side, a multiple of 4 so quarter nodes start on an
+    // even quad of their level's grid
+    uint32_t grid = 32;
+    // meters per side of level 0 nodes
+    float leaf_size = 32.f;
+    uint32_t levels = 10;
+    // level 0 range in leaf sizes, doubling per level; below ~2 a node's far
+    // corner could reach the next level's morph before its parent takes over
+    float range_ratio = 2.5f;
+    // how far from the previous level's range to a level's own the morph
+    // begins
+    float morph_start = .7f;
+};
+
+// a node as the vertex shader reads it: min corner in x and z, meters per
+// side and level
+using node = glm::vec4;
+
+inline auto node_size(const settings& s, uint32_t level) -> float
+{
+    return std::ldexp(s.leaf_size, static_cast<int>(level));
+}
+
+// distance from the eye past which level is fully morphed
+inline auto range(const settings& s, uint32_t level) -> float
+{
+    return node_size(s, level) * s.range_ratio;
+}
+
+inline auto morph_start(const settings& s, uint32_t level) -> float
+{
+    const auto end = range(s, level);
+    return end * (.5f + .5f * s.morph_start);
+}
+
+// full nodes get the whole grid; quarter nodes are the parts of a split
+// node its children don't cover, drawn at the node's level with half the
+// grid, so they match its quads
+struct selection {
+    std::vector<node> full;
+    std::vector<node> quarters;
+
+    auto size() const { return full.size() + quarters.size(); }
+
+    inline auto clear()
+    {
+        full.clear();
+        quarters.clear();
+    }
+};
+
+namespace detail {
+// whether the square at y = 0 comes within radius of the eye
+inline auto within(glm::vec3 eye, float x, float z, float size, float radius)
+{
+    const auto dx = std::clamp(eye.x, x, x + size) - eye.x;
+    const auto dz = std::clamp(eye.z, z, z + size) - eye.z;
+    return dx * dx + dz * dz + eye.y * eye.y <= radius * radius;
+}
+
+inline void select_node(const settings& s,
+                        glm::vec3 eye,
+                        float x,
+                        float z,
+                        uint32_t level,
+                        selection& out)
+{
+    const auto size = node_size(s, level);
+    if (not within(eye, x, z, size, range(s, level))) {
+        return;
+    }
+    const auto lod = static_cast<float>(level);
+    if (level == 0 or not within(eye, x, z, size, range(s, level - 1))) {
+        out.full.emplace_back(x, z, size, lod);
+        return;
+    }
+    const auto half = size * .5f;
+    for (const auto [cx, cz] : {glm::vec2{x, z},
+                                glm::vec2{x + half, z},
+                                glm::vec2{x, z + half},
+                                glm::vec2{x + half, z + half}}) {
+        if (within(eye, cx, cz, half, range(s, level - 1))) {
+            select_node(s, eye, cx, cz, level - 1, out);
+        }
+        else {
+            out.quarters.emplace_back(cx, cz, half, lod);
+        }
+    }
+}
+} // namespace detail
+
+// the nodes covering the plane within range(levels - 1) of the eye; roots
+// are aligned to their size, so nodes of a level always share edges
+inline auto select(const settings& s, glm::vec3 eye, selection& out)
+{
+    out.clear();
+    const auto top     = s.levels - 1;
+    const auto size    = node_size(s, top);
+    const auto far     = range(s, top);
+    const auto first_x = std::floor((eye.x - far) / size);
+    const auto first_z = std::floor((eye.z - far) / size);
+    const auto last_x  = std::floor((eye.x + far) / size);
+    const auto last_z  = std::floor((eye.z + far) / size);
+    for (auto z = first_z; z <= last_z; z += 1.f) {
+        for (auto x = first_x; x <= last_x; x += 1.f) {
+            detail::select_node(s, eye, x * size, z * size, top, out);
+        }
+    }
+}
+} // namespace antartar::quadtree
@@ -0,0 +1,158 @@
+#pragma once
+#include <antartar/jobs.hpp>
+#include <antartar/log.hpp>
+#include <antartar/profiler.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// records slices of a draw list into secondary command buffers as jobs; every
+// slice owns one command pool per frame in flight and only one job records a
+// slice at a time, so pools are reset without synchronization once the
+// frame's timeline value was waited on
+class parallel_recorder {
+  public:
+    // below this many items per slice a job costs more than it saves
+    static constexpr size_t min_items_per_slice = 256;
+
+  private:
+    struct slice_state {
+        // both per frame in flight, buffers are reused after a pool reset
+        std::vector<VkCommandPool> pools;
+        std::vector<VkCommandBuffer> command_buffers;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::reference_wrapper<jobs::scheduler> workers_;
+    std::vector<slice_state> slices_;
+    std::vector<VkCommandBuffer> recorded_;
+
+    inline auto create_command_pool_(uint32_t queue_family)
+    {
+        VkCommandPoolCreateInfo pool_info{
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = queue_family};
+        VkCommandPool pool = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkCreateCommandPool(device_,
+                                   std::addressof(pool_info),
+                                   nullptr,
+                                   std::addressof(pool))) {
+            throw std::runtime_error(
+                log_message("failed to create recording command pool!"sv));
+        }
+        return pool;
+    }
+
+    inline auto allocate_command_buffer_(VkCommandPool pool)
+    {
+        VkCommandBufferAllocateInfo alloc_info{
+            .sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pool,
+            .level       = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1};
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkAllocateCommandBuffers(device_,
+                                        std::addressof(alloc_info),
+                                        std::addressof(command_buffer))) {
+            throw std::runtime_error(
+                log_message("failed to allocate secondary command buffer!"sv));
+        }
+        return command_buffer;
+    }
+
+  public:
+    inline parallel_recorder(VkDevice device,
+                             uint32_t queue_family,
+                             uint32_t frames_in_flight,
+                             jobs::scheduler& workers,
+                             uint32_t max_slices)
+        : device_{device}, workers_{workers}, slices_(std::max(1u, max_slices))
+    {
+        for (auto& state : slices_) {
+            for (uint32_t frame = 0; frame < frames_in_flight; ++frame) {
+                state.pools.push_back(create_command_pool_(queue_family));
+                state.command_buffers.push_back(
+                    allocate_command_buffer_(state.pools.back()));
+            }
+        }
+        recorded_.reserve(slices_.size());
+    }
+
+    parallel_recorder(const parallel_recorder&)            = delete;
+    parallel_recorder& operator=(const parallel_recorder&) = delete;
+
+    inline ~parallel_recorder()
+    {
+        for (auto& state : slices_) {
+            for (auto pool : state.pools) {
+                vkDestroyCommandPool(device_, pool, nullptr);
+            }
+        }
+    }
+
+    auto max_slices() const
+    {
+        return static_cast<uint32_t>(slices_.size());
+    }
+
+    // how many secondary command buffers record would use for count items
+    inline auto slices_for(size_t count) const
+    {
+        return static_cast<uint32_t>(std::clamp<size_t>(
+            count / min_items_per_slice, 1, slices_.size()));
+    }
+
+    // splits [0, count) into contiguous slices and calls
+    // record_slice(command_buffer, first, last) for each as a job; the
+    // returned buffers are ordered by slice and ready for vkCmdExecuteCommands
+    inline auto record(uint32_t frame,
+                       const VkCommandBufferInheritanceInfo& inheritance,
+                       size_t count,
+                       auto&& record_slice) -> std::span<const VkCommandBuffer>
+    {
+        const auto slices = slices_for(count);
+        recorded_.resize(slices);
+        workers_.get().parallel_for(
+            slices,
+            1,
+            [&, this](size_t first_slice, size_t last_slice) {
+                for (auto slice = first_slice; slice < last_slice; ++slice) {
+                    ANTARTAR_PROFILE_ZONE("vk::record_slice");
+                    auto command_buffer =
+                        slices_.at(slice).command_buffers.at(frame);
+                    VkCommandBufferBeginInfo begin_info{
+                        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                        .flags =
+                            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+                            | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+                        .pInheritanceInfo = std::addressof(inheritance)};
+                    vkBeginCommandBuffer(command_buffer,
+                                         std::addressof(begin_info));
+                    record_slice(command_buffer,
+                                 count * slice / slices,
+                                 count * (slice + 1) / slices);
+                    vkEndCommandBuffer(command_buffer);
+                    recorded_.at(slice) = command_buffer;
+                }
+            });
+        return recorded_;
+    }
+
+    // the frame's timeline value must be reached, nothing recorded into its
+    // pools may still be pending
+    inline auto reset(uint32_t frame)
+    {
+        for (auto& state : slices_) {
+            vkResetCommandPool(device_, state.pools.at(frame), 0);
+        }
+    }
+};
+} // namespace antartar::vk
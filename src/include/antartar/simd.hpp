@@ -0,0 +1,77 @@
+#pragma once
+#include <antartar/log.hpp>
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define ANTARTAR_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// msvc emits any intrinsic, dispatch alone keeps avx2 off older cpus
+#define ANTARTAR_TARGET_AVX2
+#else
+#define ANTARTAR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define ANTARTAR_SIMD_X86 0
+#endif
+
+namespace antartar {
+enum class simd_level { scalar, sse, avx2 };
+
+inline auto simd_level_name(simd_level level)
+{
+    switch (level) {
+    case simd_level::sse:
+        return "sse"sv;
+    case simd_level::avx2:
+        return "avx2"sv;
+    case simd_level::scalar:
+        break;
+    }
+    return "scalar"sv;
+}
+
+// highest level both the cpu and the os support, sse2 is part of x86-64
+inline auto detect_simd_level() -> simd_level
+{
+#if ANTARTAR_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    std::array<int, 4> info{};
+    __cpuid(info.data(), 0);
+    const auto max_leaf = info[0];
+    __cpuid(info.data(), 1);
+    const auto osxsave = (info[2] & (1 << 27)) != 0;
+    const auto avx     = (info[2] & (1 << 28)) != 0;
+    // the os has to save ymm registers on context switches
+    if (max_leaf >= 7 and osxsave and avx and (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info.data(), 7, 0);
+        if ((info[1] & (1 << 5)) != 0) {
+            return simd_level::avx2;
+        }
+    }
+    return simd_level::sse;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? simd_level::avx2
+                                          : simd_level::sse;
+#endif
+#else
+    return simd_level::scalar;
+#endif
+}
+
+inline auto supported_simd_level()
+{
+    static const auto level = detect_simd_level();
+    return level;
+}
+
+// levels the cpu lacks fall back to the best one it has
+inline auto usable_simd_level(simd_level level)
+{
+    return std::min(level, supported_simd_level());
+}
+} // namespace antartar
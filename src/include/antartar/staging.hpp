@@ -0,0 +1,553 @@
+#pragma once
+#include <antartar/gpu_profiler.hpp>
+#include <antartar/log.hpp>
+#include <antartar/memory.hpp>
+#include <antartar/timeline.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// value of the destination queue timeline after which an upload is visible on
+// that queue
+using upload_ticket = uint64_t;
+
+struct queue_endpoint {
+    uint32_t family = 0;
+    VkQueue queue   = VK_NULL_HANDLE;
+};
+
+// persistently mapped upload ring, writes land at head_ and the range up to
+// tail_ is owned by submissions the gpu hasn't finished yet
+//
+// copies run on the source queue (a dedicated transfer queue when the device
+// has one); buffers are then released to the destination family and acquired
+// by a small submit on the destination queue; each queue signals a timeline of
+// its own, since values of one timeline have to increase in the order the
+// signals execute and two queues don't order their submits against each other
+class staging_ring {
+  public:
+    static constexpr VkDeviceSize default_capacity = 16ull << 20;
+    // submissions timed at once, later ones go untimed until a slot frees up
+    static constexpr uint32_t max_timed_submissions = 32;
+
+    // stages of the destination queue allowed to read uploaded buffers
+    static constexpr VkPipelineStageFlags consumer_stages =
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+        | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+        | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    static constexpr VkAccessFlags consumer_access =
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+        | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+  private:
+    struct timeline_point {
+        VkSemaphore semaphore;
+        uint64_t value;
+    };
+
+    struct pending_copy {
+        VkBuffer dst_buffer;
+        VkBufferCopy region;
+    };
+
+    struct submission {
+        VkCommandBuffer copy_command_buffer    = VK_NULL_HANDLE;
+        VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE;
+        upload_ticket ticket                   = 0;
+        // ring position released once the ticket completes
+        VkDeviceSize end = 0;
+        // pair of timestamp queries around the copies
+        std::optional<uint32_t> query_slot;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::reference_wrapper<memory_allocator> allocator_;
+    queue_endpoint src_;
+    queue_endpoint dst_;
+    VkCommandPool src_command_pool_ = VK_NULL_HANDLE;
+    VkCommandPool dst_command_pool_ = VK_NULL_HANDLE;
+    // signaled by the copies on the source queue, waited on by the acquires
+    // when ownership moves to the destination family
+    timeline_semaphore copy_timeline_;
+    // signaled on the destination queue, tickets are its values
+    timeline_semaphore timeline_;
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    memory_allocation memory_;
+    VkDeviceSize capacity_ = 0;
+    // monotonic positions, the ring offset is position % capacity_
+    VkDeviceSize head_ = 0;
+    VkDeviceSize tail_ = 0;
+    std::vector<pending_copy> pending_;
+    std::deque<submission> in_flight_;
+    std::vector<submission> recycled_;
+    std::optional<timestamp_properties> timestamps_;
+    VkQueryPool query_pool_ = VK_NULL_HANDLE;
+    std::vector<uint32_t> free_query_slots_;
+    double retired_gpu_milliseconds_ = 0.;
+
+    auto transfers_ownership_() const { return src_.family != dst_.family; }
+
+    inline auto create_buffer_()
+    {
+        VkBufferCreateInfo buffer_info{
+            .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size        = capacity_,
+            .usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+        if (VK_SUCCESS
+            != vkCreateBuffer(device_,
+                              std::addressof(buffer_info),
+                              nullptr,
+                              std::addressof(buffer_))) {
+            throw std::runtime_error(
+                log_message("failed to create staging ring buffer!"sv));
+        }
+        VkMemoryRequirements memory_requirements;
+        vkGetBufferMemoryRequirements(device_,
+                                      buffer_,
+                                      std::addressof(memory_requirements));
+        memory_ = allocator_.get().allocate(
+            memory_requirements,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        vkBindBufferMemory(device_, buffer_, memory_.memory, memory_.offset);
+    }
+
+    inline auto create_command_pool_(uint32_t queue_family) -> VkCommandPool
+    {
+        VkCommandPoolCreateInfo pool_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+                     | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = queue_family};
+        VkCommandPool pool = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkCreateCommandPool(device_,
+                                   std::addressof(pool_info),
+                                   nullptr,
+                                   std::addressof(pool))) {
+            throw std::runtime_error(
+                log_message("failed to create staging command pool!"sv));
+        }
+        return pool;
+    }
+
+    inline auto create_query_pool_()
+    {
+        VkQueryPoolCreateInfo pool_info{
+            .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2 * max_timed_submissions};
+        if (VK_SUCCESS
+            != vkCreateQueryPool(device_,
+                                 std::addressof(pool_info),
+                                 nullptr,
+                                 std::addressof(query_pool_))) {
+            throw std::runtime_error(
+                log_message("failed to create staging query pool!"sv));
+        }
+        // reset from the host, a dedicated transfer queue can write timestamps
+        // but not record vkCmdResetQueryPool
+        vkResetQueryPool(device_, query_pool_, 0, 2 * max_timed_submissions);
+        for (uint32_t slot = max_timed_submissions; slot > 0; --slot) {
+            free_query_slots_.push_back(slot - 1);
+        }
+    }
+
+    inline auto allocate_command_buffer_(VkCommandPool pool)
+    {
+        VkCommandBufferAllocateInfo alloc_info{
+            .sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pool,
+            .level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1};
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        if (VK_SUCCESS
+            != vkAllocateCommandBuffers(device_,
+                                        std::addressof(alloc_info),
+                                        std::addressof(command_buffer))) {
+            throw std::runtime_error(
+                log_message("failed to allocate staging command buffer!"sv));
+        }
+        return command_buffer;
+    }
+
+    inline auto acquire_submission_() -> submission
+    {
+        if (not recycled_.empty()) {
+            auto recycled = recycled_.back();
+            recycled_.pop_back();
+            vkResetCommandBuffer(recycled.copy_command_buffer, 0);
+            if (transfers_ownership_()) {
+                vkResetCommandBuffer(recycled.acquire_command_buffer, 0);
+            }
+            return recycled;
+        }
+        submission result;
+        result.copy_command_buffer =
+            allocate_command_buffer_(src_command_pool_);
+        if (transfers_ownership_()) {
+            result.acquire_command_buffer =
+                allocate_command_buffer_(dst_command_pool_);
+        }
+        return result;
+    }
+
+    // the ticket completed, so results are available without waiting
+    inline auto collect_timestamps_(submission& retired)
+    {
+        if (not retired.query_slot) {
+            return;
+        }
+        std::array<uint64_t, 2> ticks{};
+        if (VK_SUCCESS
+            == vkGetQueryPoolResults(device_,
+                                     query_pool_,
+                                     2 * *retired.query_slot,
+                                     2,
+                                     sizeof(ticks),
+                                     ticks.data(),
+                                     sizeof(uint64_t),
+                                     VK_QUERY_RESULT_64_BIT)) {
+            retired_gpu_milliseconds_ +=
+                timestamps_->to_milliseconds(ticks[0], ticks[1]);
+        }
+        vkResetQueryPool(device_, query_pool_, 2 * *retired.query_slot, 2);
+        free_query_slots_.push_back(*retired.query_slot);
+        retired.query_slot.reset();
+    }
+
+    inline auto retire_front_()
+    {
+        auto& front = in_flight_.front();
+        collect_timestamps_(front);
+        tail_ = front.end;
+        recycled_.push_back(front);
+        in_flight_.pop_front();
+    }
+
+    inline auto wait_oldest_()
+    {
+        wait(in_flight_.front().ticket);
+        retire_front_();
+    }
+
+    // returns ring position with size bytes free, flushing and waiting on the
+    // gpu only when the ring is full
+    inline auto reserve_(VkDeviceSize size, VkDeviceSize alignment)
+        -> VkDeviceSize
+    {
+        for (;;) {
+            auto position = (head_ + alignment - 1) / alignment * alignment;
+            // don't let a region straddle the end of the buffer
+            if (position % capacity_ + size > capacity_) {
+                position = (position / capacity_ + 1) * capacity_;
+            }
+            if (position + size - tail_ <= capacity_) {
+                head_ = position + size;
+                return position;
+            }
+            if (in_flight_.empty()) {
+                flush();
+            }
+            if (in_flight_.empty()) {
+                // nothing pending and nothing in flight, ring is empty
+                head_ = tail_ = 0;
+                continue;
+            }
+            wait_oldest_();
+        }
+    }
+
+    inline auto record_copies_(VkCommandBuffer command_buffer)
+    {
+        // consecutive copies into the same buffer share one vkCmdCopyBuffer
+        std::vector<VkBufferCopy> regions;
+        for (auto first = std::begin(pending_); first != std::end(pending_);) {
+            auto last = std::find_if(first, std::end(pending_), [&](auto& c) {
+                return c.dst_buffer != first->dst_buffer;
+            });
+            regions.clear();
+            std::transform(first,
+                           last,
+                           std::back_inserter(regions),
+                           [](const pending_copy& c) { return c.region; });
+            vkCmdCopyBuffer(command_buffer,
+                            buffer_,
+                            first->dst_buffer,
+                            static_cast<uint32_t>(regions.size()),
+                            regions.data());
+            first = last;
+        }
+    }
+
+    inline auto ownership_barriers_(VkAccessFlags src_access,
+                                    VkAccessFlags dst_access) const
+    {
+        std::vector<VkBufferMemoryBarrier> barriers;
+        barriers.reserve(pending_.size());
+        for (const auto& c : pending_) {
+            barriers.push_back(
+                {.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                 .srcAccessMask       = src_access,
+                 .dstAccessMask       = dst_access,
+                 .srcQueueFamilyIndex = src_.family,
+                 .dstQueueFamilyIndex = dst_.family,
+                 .buffer              = c.dst_buffer,
+                 .offset              = c.region.dstOffset,
+                 .size                = c.region.size});
+        }
+        return barriers;
+    }
+
+    inline auto submit_(VkQueue queue,
+                        VkCommandBuffer command_buffer,
+                        std::optional<timeline_point> wait,
+                        timeline_point signal)
+    {
+        const VkPipelineStageFlags wait_stage = consumer_stages;
+        const auto wait_point = wait.value_or(timeline_point{});
+        VkTimelineSemaphoreSubmitInfo timeline_info{
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .waitSemaphoreValueCount   = wait ? 1u : 0u,
+            .pWaitSemaphoreValues      = std::addressof(wait_point.value),
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues    = std::addressof(signal.value)};
+        VkSubmitInfo submit_info{
+            .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext                = std::addressof(timeline_info),
+            .waitSemaphoreCount   = wait ? 1u : 0u,
+            .pWaitSemaphores      = std::addressof(wait_point.semaphore),
+            .pWaitDstStageMask    = std::addressof(wait_stage),
+            .commandBufferCount   = 1,
+            .pCommandBuffers      = std::addressof(command_buffer),
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores    = std::addressof(signal.semaphore)};
+        if (VK_SUCCESS
+            != vkQueueSubmit(queue,
+                             1,
+                             std::addressof(submit_info),
+                             VK_NULL_HANDLE)) {
+            throw std::runtime_error(
+                log_message("failed to submit staging uploads!"sv));
+        }
+    }
+
+  public:
+    inline staging_ring(VkDevice device,
+                        memory_allocator& allocator,
+                        queue_endpoint src,
+                        queue_endpoint dst,
+                        std::optional<timestamp_properties> timestamps =
+                            std::nullopt,
+                        VkDeviceSize capacity = default_capacity)
+        : device_{device},
+          allocator_{allocator},
+          src_{src},
+          dst_{dst},
+          copy_timeline_{device},
+          timeline_{device},
+          capacity_{capacity},
+          timestamps_{timestamps}
+    {
+        create_buffer_();
+        if (timestamps_) {
+            create_query_pool_();
+        }
+        src_command_pool_ = create_command_pool_(src_.family);
+        if (transfers_ownership_()) {
+            dst_command_pool_ = create_command_pool_(dst_.family);
+        }
+    }
+
+    staging_ring(const staging_ring&)            = delete;
+    staging_ring& operator=(const staging_ring&) = delete;
+
+    inline ~staging_ring()
+    {
+        flush();
+        wait(last_ticket());
+        vkDestroyCommandPool(device_, src_command_pool_, nullptr);
+        if (transfers_ownership_()) {
+            vkDestroyCommandPool(device_, dst_command_pool_, nullptr);
+        }
+        vkDestroyQueryPool(device_, query_pool_, nullptr);
+        vkDestroyBuffer(device_, buffer_, nullptr);
+        allocator_.get().free(memory_);
+    }
+
+    // copies data into the ring now, the gpu copy into dst_buffer is recorded
+    // on the next flush
+    inline auto upload(VkBuffer dst_buffer,
+                       VkDeviceSize dst_offset,
+                       std::span<const std::byte> data,
+                       VkDeviceSize alignment = 16)
+    {
+        while (not data.empty()) {
+            const auto chunk_size = std::min<VkDeviceSize>(data.size(),
+                                                           capacity_);
+            const auto position   = reserve_(chunk_size, alignment);
+            const auto offset     = position % capacity_;
+            std::memcpy(static_cast<std::byte*>(memory_.mapped) + offset,
+                        data.data(),
+                        chunk_size);
+            pending_.push_back({.dst_buffer = dst_buffer,
+                                .region     = {.srcOffset = offset,
+                                               .dstOffset = dst_offset,
+                                               .size      = chunk_size}});
+            dst_offset += chunk_size;
+            data = data.subspan(chunk_size);
+        }
+    }
+
+    // batches every pending copy into a single submit, never blocks; the
+    // returned ticket is reached once the data is usable on the destination
+    // queue
+    inline auto flush() -> upload_ticket
+    {
+        if (pending_.empty()) {
+            return last_ticket();
+        }
+        auto current = acquire_submission_();
+        current.end  = head_;
+
+        VkCommandBufferBeginInfo begin_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+        vkBeginCommandBuffer(current.copy_command_buffer,
+                             std::addressof(begin_info));
+        if (timestamps_ and not free_query_slots_.empty()) {
+            current.query_slot = free_query_slots_.back();
+            free_query_slots_.pop_back();
+            vkCmdWriteTimestamp(current.copy_command_buffer,
+                                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                query_pool_,
+                                2 * *current.query_slot);
+        }
+        record_copies_(current.copy_command_buffer);
+        if (current.query_slot) {
+            vkCmdWriteTimestamp(current.copy_command_buffer,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                query_pool_,
+                                2 * *current.query_slot + 1);
+        }
+
+        if (not transfers_ownership_()) {
+            // later submissions on this queue see the uploaded data
+            VkMemoryBarrier barrier{
+                .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = consumer_access};
+            vkCmdPipelineBarrier(current.copy_command_buffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 consumer_stages,
+                                 0,
+                                 1,
+                                 std::addressof(barrier),
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr);
+            vkEndCommandBuffer(current.copy_command_buffer);
+            current.ticket = timeline_.reserve();
+            submit_(src_.queue,
+                    current.copy_command_buffer,
+                    std::nullopt,
+                    {timeline_.handle(), current.ticket});
+        }
+        else {
+            // release on the transfer queue ...
+            auto release = ownership_barriers_(VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+            vkCmdPipelineBarrier(current.copy_command_buffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 static_cast<uint32_t>(release.size()),
+                                 release.data(),
+                                 0,
+                                 nullptr);
+            vkEndCommandBuffer(current.copy_command_buffer);
+
+            // ... and acquire on the destination queue once copies are done
+            vkBeginCommandBuffer(current.acquire_command_buffer,
+                                 std::addressof(begin_info));
+            auto acquire = ownership_barriers_(0, consumer_access);
+            vkCmdPipelineBarrier(current.acquire_command_buffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 consumer_stages,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 static_cast<uint32_t>(acquire.size()),
+                                 acquire.data(),
+                                 0,
+                                 nullptr);
+            vkEndCommandBuffer(current.acquire_command_buffer);
+
+            const timeline_point copied{copy_timeline_.handle(),
+                                        copy_timeline_.reserve()};
+            current.ticket = timeline_.reserve();
+            submit_(src_.queue,
+                    current.copy_command_buffer,
+                    std::nullopt,
+                    copied);
+            submit_(dst_.queue,
+                    current.acquire_command_buffer,
+                    copied,
+                    {timeline_.handle(), current.ticket});
+        }
+        in_flight_.push_back(current);
+        pending_.clear();
+        return current.ticket;
+    }
+
+    // releases ring space of every submission the gpu already finished
+    inline auto retire()
+    {
+        const auto reached = completed_ticket();
+        while (not in_flight_.empty()
+               and in_flight_.front().ticket <= reached) {
+            retire_front_();
+        }
+    }
+
+    inline auto completed_ticket() const -> upload_ticket
+    {
+        return timeline_.completed();
+    }
+
+    inline auto wait(upload_ticket ticket) const -> void
+    {
+        timeline_.wait(ticket);
+    }
+
+    // lets other queues wait on uploads with their own submits
+    auto timeline() const { return timeline_.handle(); }
+
+    auto last_ticket() const -> upload_ticket
+    {
+        return timeline_.last_reserved();
+    }
+
+    auto bytes_in_flight() const { return head_ - tail_; }
+
+    // gpu time of the copies retired since the previous call, 0 when the
+    // source queue can't write timestamps
+    inline auto take_gpu_milliseconds()
+    {
+        return std::exchange(retired_gpu_milliseconds_, 0.);
+    }
+};
+} // namespace antartar::vk
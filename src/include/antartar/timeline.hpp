@@ -0,0 +1,79 @@
+#pragma once
+#include <antartar/log.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// VK_SEMAPHORE_TYPE_TIMELINE semaphore plus the last value handed out to a
+// signal operation; a value is reserved before the submit that signals it, so
+// anything recorded for that submit can already key off the value
+//
+// one per queue: signals have to execute in increasing value order, which
+// only the submission order of a single queue guarantees, so work on another
+// queue signals its own timeline and the two are chained by waits
+class timeline_semaphore {
+  private:
+    VkDevice device_       = VK_NULL_HANDLE;
+    VkSemaphore semaphore_ = VK_NULL_HANDLE;
+    uint64_t last_value_   = 0;
+
+  public:
+    inline explicit timeline_semaphore(VkDevice device) : device_{device}
+    {
+        VkSemaphoreTypeCreateInfo type_info{
+            .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue  = 0};
+        VkSemaphoreCreateInfo semaphore_info{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = std::addressof(type_info)};
+        if (VK_SUCCESS
+            != vkCreateSemaphore(device_,
+                                 std::addressof(semaphore_info),
+                                 nullptr,
+                                 std::addressof(semaphore_))) {
+            throw std::runtime_error(
+                log_message("failed to create timeline semaphore!"sv));
+        }
+    }
+
+    timeline_semaphore(const timeline_semaphore&)            = delete;
+    timeline_semaphore& operator=(const timeline_semaphore&) = delete;
+
+    inline ~timeline_semaphore()
+    {
+        vkDestroySemaphore(device_, semaphore_, nullptr);
+    }
+
+    auto handle() const { return semaphore_; }
+
+    // value for the next signal operation, every reserved value has to be
+    // signaled, in order and from the queue that owns this timeline, or later
+    // waits never return
+    auto reserve() { return ++last_value_; }
+
+    auto last_reserved() const { return last_value_; }
+
+    inline auto completed() const
+    {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(device_, semaphore_, std::addressof(value));
+        return value;
+    }
+
+    // false on timeout
+    inline auto wait(uint64_t value, uint64_t timeout_ns = UINT64_MAX) const
+    {
+        VkSemaphoreWaitInfo wait_info{
+            .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores    = std::addressof(semaphore_),
+            .pValues        = std::addressof(value)};
+        return VK_SUCCESS
+               == vkWaitSemaphores(device_,
+                                   std::addressof(wait_info),
+                                   timeout_ns);
+    }
+};
+} // namespace antartar::vk
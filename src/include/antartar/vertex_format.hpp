@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vulkan/vulkan.h>
+
+namespace antartar::vk {
+// ieee 754 binary16, rounded to nearest even like the device converts;
+// overflow goes to infinity, nan stays nan
+inline auto float_to_half(float value) -> uint16_t
+{
+    const auto bits     = std::bit_cast<uint32_t>(value);
+    const auto sign     = (bits >> 16) & 0x8000u;
+    const auto biased   = (bits >> 23) & 0xffu;
+    auto mantissa       = bits & 0x7fffffu;
+    const auto exponent = static_cast<int32_t>(biased) - 127 + 15;
+    if (biased == 0xffu) {
+        return static_cast<uint16_t>(sign | 0x7c00u
+                                     | (mantissa != 0 ? 0x200u : 0u));
+    }
+    if (exponent >= 0x1f) {
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    // subnormal halves keep the implicit bit in the mantissa
+    auto shift = 13u;
+    auto half  = static_cast<uint32_t>(exponent) << 10;
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000u;
+        shift = static_cast<uint32_t>(14 - exponent);
+        half  = 0;
+    }
+    half |= mantissa >> shift;
+    const auto rest    = mantissa & ((1u << shift) - 1);
+    const auto halfway = 1u << (shift - 1);
+    // a carry out of the mantissa bumps the exponent, up to infinity
+    if (rest > halfway or (rest == halfway and (half & 1u) != 0)) {
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+inline auto half_to_float(uint16_t half) -> float
+{
+    const auto sign     = static_cast<uint32_t>(half & 0x8000u) << 16;
+    const auto exponent = (half >> 10) & 0x1fu;
+    const auto mantissa = half & 0x3ffu;
+    if (exponent == 0) {
+        const auto magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -magnitude : magnitude;
+    }
+    const auto bits =
+        exponent == 0x1fu
+            ? sign | 0x7f800000u | (mantissa << 13)
+            : sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    return std::bit_cast<float>(bits);
+}
+
+// a unit vector folded onto the octahedron and unfolded into the square,
+// both components in [-1, 1]; spreads the error evenly over the sphere
+// unlike storing two of the three components
+inline auto encode_octahedral(glm::vec3 n) -> glm::vec2
+{
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (n.z >= 0.f) {
+        return {n.x, n.y};
+    }
+    return {(1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f),
+            (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f)};
+}
+
+// what a shader does with an octahedral attribute
+inline auto decode_octahedral(glm::vec2 e) -> glm::vec3
+{
+    glm::vec3 n{e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y)};
+    const auto fold = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -fold : fold;
+    n.y += n.y >= 0.f ? -fold : fold;
+    return glm::normalize(n);
+}
+
+namespace detail {
+inline auto to_snorm16(float value) -> int16_t
+{
+    return static_cast<int16_t>(
+        std::round(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+inline auto to_unorm8(float value) -> uint8_t
+{
+    return static_cast<uint8_t>(
+        std::round(std::clamp(value, 0.f, 1.f) * 255.f));
+}
+} // namespace detail
+
+// packed attributes, each converts from the float vector it stands for and
+// names the format the vertex shader reads back as floats
+
+// positions scaled into [-1, 1]
+struct snorm16x2 {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+    std::array<int16_t, 2> value{};
+
+    snorm16x2() = default;
+
+    snorm16x2(glm::vec2 v)
+        : value{detail::to_snorm16(v.x), detail::to_snorm16(v.y)}
+    {}
+
+    // what the vertex shader reads
+    auto unpack() const -> glm::vec2
+    {
+        return {std::max(static_cast<float>(value[0]) / 32767.f, -1.f),
+                std::max(static_cast<float>(value[1]) / 32767.f, -1.f)};
+    }
+};
+
+// three component 16 bit formats are rarely vertex buffer capable, w is
+// padding read as 1 so the shader gets a homogeneous point
+struct snorm16x4 {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SNORM;
+    std::array<int16_t, 4> value{};
+
+    snorm16x4() = default;
+
+    snorm16x4(glm::vec3 v)
+        : value{detail::to_snorm16(v.x),
+                detail::to_snorm16(v.y),
+                detail::to_snorm16(v.z),
+                32767}
+    {}
+};
+
+// unit normals, see encode_octahedral
+struct octahedral16 {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+    std::array<int16_t, 2> value{};
+
+    octahedral16() = default;
+
+    octahedral16(glm::vec3 normal)
+    {
+        const auto e = encode_octahedral(normal);
+        value        = {detail::to_snorm16(e.x), detail::to_snorm16(e.y)};
+    }
+};
+
+// colors, alpha 1 when given three components
+struct unorm8x4 {
+    static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    std::array<uint8_t, 4> value{};
+
+    unorm8x4() = default;
+
+    unorm8x4(glm::vec4 v)
+        : value{detail::to_unorm8(v.x),
+                detail::to_unorm8(v.y),
+                detail::to_unorm8(v.z),
+                detail::to_unorm8(v.w)}
+    {}
+
+    unorm8x4(glm::vec3 v) : unorm8x4{glm::vec4{v, 1.f}} {}
+};
+
+// texture coordinates and small grid positions, exact for multiples of
+// 2^-10 up to 1
+struct half2 {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+    std::array<uint16_t, 2> value{};
+
+    half2() = default;
+
+    half2(glm::vec2 v) : value{float_to_half(v.x), float_to_half(v.y)} {}
+};
+
+// the format a member of type T is read with
+template<typename T> constexpr VkFormat attribute_format = T::format;
+template<> constexpr VkFormat attribute_format<float> = VK_FORMAT_R32_SFLOAT;
+template<>
+constexpr VkFormat attribute_format<glm::vec2> = VK_FORMAT_R32G32_SFLOAT;
+template<>
+constexpr VkFormat attribute_format<glm::vec3> = VK_FORMAT_R32G32B32_SFLOAT;
+template<>
+constexpr VkFormat attribute_format<glm::vec4> =
+    VK_FORMAT_R32G32B32A32_SFLOAT;
+
+// a vertex buffer element: standard layout, its input rate and a tuple of
+// pointers to the members the shader reads, in location order
+template<typename V>
+concept vertex_layout = std::is_standard_layout_v<V>
+                        and std::is_default_constructible_v<V>
+                        and requires {
+                                { V::input_rate }
+                                    -> std::convertible_to<VkVertexInputRate>;
+                                V::members();
+                            };
+
+template<vertex_layout V>
+constexpr uint32_t attribute_count =
+    std::tuple_size_v<decltype(V::members())>;
+
+namespace detail {
+// standard layout puts a member at the same offset in every object
+template<typename V, typename M> auto member_offset(M V::*member) -> uint32_t
+{
+    const V object{};
+    return static_cast<uint32_t>(
+        reinterpret_cast<const std::byte*>(std::addressof(object.*member))
+        - reinterpret_cast<const std::byte*>(std::addressof(object)));
+}
+
+template<vertex_layout V>
+auto append_attributes(uint32_t binding,
+                       uint32_t& location,
+                       VkVertexInputAttributeDescription*& out)
+{
+    std::apply(
+        [&](auto... members) {
+            ((*out++ =
+                  {.location = location++,
+                   .binding  = binding,
+                   .format   = attribute_format<std::remove_cvref_t<
+                       decltype(std::declval<V&>().*members)>>,
+                   .offset   = member_offset(members)}),
+             ...);
+        },
+        V::members());
+}
+} // namespace detail
+
+// a binding per type in order
+template<vertex_layout... Vs>
+auto vertex_input_bindings()
+    -> std::array<VkVertexInputBindingDescription, sizeof...(Vs)>
+{
+    uint32_t binding = 0;
+    return {VkVertexInputBindingDescription{
+        .binding   = binding++,
+        .stride    = static_cast<uint32_t>(sizeof(Vs)),
+        .inputRate = Vs::input_rate}...};
+}
+
+// the types' members at consecutive locations from 0, each type on the
+// binding vertex_input_bindings gives it
+template<vertex_layout... Vs>
+auto vertex_input_attributes()
+    -> std::array<VkVertexInputAttributeDescription,
+                  (attribute_count<Vs> + ... + 0)>
+{
+    std::array<VkVertexInputAttributeDescription,
+               (attribute_count<Vs> + ... + 0)>
+        attributes{};
+    auto* out         = attributes.data();
+    uint32_t binding  = 0;
+    uint32_t location = 0;
+    (detail::append_attributes<Vs>(binding++, location, out), ...);
+    return attributes;
+}
+} // namespace antartar::vk
@@ -2,13 +2,33 @@
 #include <type_traits>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <antartar/culling.hpp>
+#include <antartar/deletion.hpp>
+#include <antartar/depth_pyramid.hpp>
 #include <antartar/file.hpp>
+#include <antartar/gpu_ocean.hpp>
+#include <antartar/gpu_profiler.hpp>
+#include <antartar/indirect.hpp>
+#include <antartar/jobs.hpp>
 #include <antartar/log.hpp>
+#include <antartar/memory.hpp>
+#include <antartar/mesh.hpp>
+#include <antartar/ocean.hpp>
+#include <antartar/pacing.hpp>
+#include <antartar/pipeline_cache.hpp>
+#include <antartar/profiler.hpp>
+#include <antartar/recording.hpp>
+#include <antartar/staging.hpp>
+#include <antartar/timeline.hpp>
+#include <antartar/vertex_format.hpp>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
 #include <gsl/gsl>
 #include <optional>
 #include <range/v3/all.hpp>
 #include <set>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -35,13 +55,47 @@ bool one_of(const auto& value, auto... values)
     return ((value == values) || ...);
 }
 
+// window stand-in without a surface, frames are rendered into offscreen
+// images and optionally read back to the host
+template<typename WindowT>
+concept offscreen_target = requires(WindowT& window,
+                                    std::span<const std::byte> pixels) {
+    { window.extent() } -> std::convertible_to<VkExtent2D>;
+    { window.readback() } -> std::convertible_to<bool>;
+    window.present(pixels);
+};
+
+struct startup_timings {
+    std::chrono::duration<double, std::milli> total;
+    std::chrono::duration<double, std::milli> pipelines;
+    bool warm_pipeline_cache = false;
+};
+
+// cpu side of the last draw_frame
+struct frame_timings {
+    using duration = std::chrono::duration<double, std::milli>;
+    // frame slot wait plus swap chain image acquire
+    duration acquire;
+    // the frame graph, command recording overlapped with upload flushing
+    duration record;
+    duration submit;
+    duration present;
+    // from the start of draw_frame, right after input was polled, until the
+    // frame was seen on screen; set when a present completed during this
+    // draw_frame, which needs VK_KHR_present_wait
+    std::optional<duration> input_to_present;
+};
+
 constexpr std::array validation_layers = {"VK_LAYER_KHRONOS_validation"};
 
 constexpr std::array device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-constexpr bool enable_validation_layers = ANTARTAR_IS_DEBUG;
+// optional, enabled when the device has both
+constexpr std::array present_wait_extensions = {
+    VK_KHR_PRESENT_ID_EXTENSION_NAME,
+    VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
 
-constexpr int max_frames_in_flight = 2;
+constexpr bool enable_validation_layers = ANTARTAR_IS_DEBUG;
 
 static inline VKAPI_ATTR VkBool32 VKAPI_CALL
 debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
@@ -49,7 +103,18 @@ debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
                const VkDebugUtilsMessengerCallbackDataEXT* callback_data,
                void* user_data)
 {
-    fmt::print(stderr, "validation layer: {}\n", callback_data->pMessage);
+    // runs on whatever thread called into the driver, often the render thread
+    if (message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        log<severity::error>("validation layer: {}", callback_data->pMessage);
+    }
+    else if (message_severity
+             >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        log<severity::warning>("validation layer: {}",
+                               callback_data->pMessage);
+    }
+    else {
+        log<severity::debug>("validation layer: {}", callback_data->pMessage);
+    }
     return VK_FALSE;
 }
 
@@ -86,11 +151,18 @@ DestroyDebugUtilsMessengerEXT(VkInstance instance,
 struct queue_family_indices {
     std::optional<uint32_t> graphics_family;
     std::optional<uint32_t> present_family;
+    // transfer-only family, uploads fall back to graphics without it
+    std::optional<uint32_t> transfer_family;
 
     inline auto is_complete() const
     {
         return graphics_family.has_value() and present_family.has_value();
     }
+
+    inline auto upload_family() const
+    {
+        return transfer_family.value_or(graphics_family.value());
+    }
 };
 
 struct swap_chain_support_details {
@@ -99,46 +171,76 @@ struct swap_chain_support_details {
     std::vector<VkPresentModeKHR> present_modes;
 };
 
+// 8 bytes, the quad's corners fit snorm16 as they are
 struct vertex {
-    glm::vec2 pos;
-    glm::vec3 color;
+    static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    static auto get_binding_description() -> VkVertexInputBindingDescription
-    {
-        return {.binding   = 0,
-                .stride    = sizeof(vertex),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
-    }
+    snorm16x2 pos;
+    unorm8x4 color;
 
-    static auto get_attribute_descriptions()
-    {
-        VkVertexInputAttributeDescription position_attribute{
-            .location = 0,
-            .binding  = 0,
-            .format   = VK_FORMAT_R32G32_SFLOAT,
-            .offset   = offsetof(vertex, pos)};
-        VkVertexInputAttributeDescription color_attribute{
-            .location = 1,
-            .binding  = 0,
-            .format   = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset   = offsetof(vertex, color)};
-        std::array attributes = {position_attribute, color_attribute};
-        return attributes;
-    }
+    static auto members() { return std::tuple{&vertex::pos, &vertex::color}; }
 };
 
 const std::vector<vertex> vertices = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    { {0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    {  {0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-    { {-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+    {glm::vec2{-0.5f, -0.5f}, glm::vec3{1.0f, 0.0f, 0.0f}},
+    { glm::vec2{0.5f, -0.5f}, glm::vec3{0.0f, 1.0f, 0.0f}},
+    {  glm::vec2{0.5f, 0.5f}, glm::vec3{0.0f, 0.0f, 1.0f}},
+    { glm::vec2{-0.5f, 0.5f}, glm::vec3{1.0f, 1.0f, 1.0f}}
 };
 
 const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0};
 
+// per instance input, the quad is scaled, then moved and its color tinted
+struct instance {
+    static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    // xy offset, zw scale
+    glm::vec4 transform{0.f, 0.f, 1.f, 1.f};
+    glm::vec4 tint{1.f};
+    // 0 nearest, 1 farthest
+    float depth = 0.f;
+
+    static auto members()
+    {
+        return std::tuple{
+            &instance::transform, &instance::tint, &instance::depth};
+    }
+};
+
+// one vkCmdDrawIndexed of the frame's draw list
+struct draw_item {
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t instance_count = 1;
+    uint32_t first_instance = 0;
+    // min xy, max xy in normalized device coordinates, for culling
+    glm::vec4 bounds{-1.f, -1.f, 1.f, 1.f};
+    // nearest depth of any instance, for occlusion culling
+    float depth = 0.f;
+};
+
 template<typename WindowT> class vk {
   private:
+    static constexpr bool headless_ = offscreen_target<WindowT>;
+    // tightly packed rgba8, what headless readback hands to the window
+    static constexpr VkFormat offscreen_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // present ids of the last frames, to match completed presents with the
+    // start of their frame
+    static constexpr uint64_t tracked_presents = 8;
+    static constexpr uint64_t present_wait_timeout_ns = 100'000'000;
+
     std::reference_wrapper<WindowT> window_;
+    frame_pacing pacing_;
+    uint32_t frames_in_flight_     = 2;
+    VkPresentModeKHR present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+    // null when VK_KHR_present_wait isn't supported
+    PFN_vkWaitForPresentKHR wait_for_present_ = nullptr;
+    std::array<std::chrono::steady_clock::time_point, tracked_presents>
+        present_starts_{};
+    uint64_t next_present_id_       = 1;
+    uint64_t oldest_unseen_present_ = 1;
     VkInstance instance_                      = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT debug_messenger_ = VK_NULL_HANDLE;
     VkSurfaceKHR surface_                     = VK_NULL_HANDLE;
@@ -146,24 +248,89 @@ template<typename WindowT> class vk {
     VkDevice device_                          = VK_NULL_HANDLE;
     VkQueue graphics_queue_                   = VK_NULL_HANDLE;
     VkQueue present_queue_                    = VK_NULL_HANDLE;
+    VkQueue transfer_queue_                   = VK_NULL_HANDLE;
     VkSwapchainKHR swap_chain_                = VK_NULL_HANDLE;
     std::pmr::vector<VkImage> swap_chain_images_{};
     VkFormat swap_chain_image_format_ = VkFormat::VK_FORMAT_UNDEFINED;
     VkExtent2D swap_chain_extent_{};
     std::pmr::vector<VkImageView> swap_chain_image_views_{};
+    // one depth buffer shared by all frames, the render pass orders them; it
+    // stays readable afterwards for the next frame's depth pyramid
+    VkFormat depth_format_ = VK_FORMAT_UNDEFINED;
+    VkImage depth_image_   = VK_NULL_HANDLE;
+    memory_allocation depth_image_memory_;
+    VkImageView depth_image_view_ = VK_NULL_HANDLE;
+    // set once a frame rendered into the current depth buffer
+    bool depth_history_ = false;
+    // headless only, backing memory of swap_chain_images_
+    std::pmr::vector<memory_allocation> offscreen_memory_{};
+    std::pmr::vector<VkBuffer> readback_buffers_{};
+    std::pmr::vector<memory_allocation> readback_memory_{};
+    std::array<bool, max_frames_in_flight> readback_pending_{};
     VkRenderPass render_pass_;
     VkPipelineLayout pipeline_layout_;
     VkPipeline graphics_pipeline_;
     std::pmr::vector<VkFramebuffer> swap_chain_framebuffers_{};
     VkCommandPool command_pool_;
+    std::optional<memory_allocator> allocator_;
+    std::optional<staging_ring> staging_;
+    std::optional<pipeline_cache> pipeline_cache_;
+    std::optional<gpu_profiler> gpu_profiler_;
+    std::optional<parallel_recorder> recorder_;
+    // needs multiDrawIndirect and drawIndirectFirstInstance, the count buffer
+    // drawIndirectCount on top
+    bool indirect_supported_  = false;
+    bool draw_indirect_count_ = false;
+    bool use_indirect_        = true;
+    std::optional<indirect_draws> indirect_;
+    // culls indirect draws hidden behind the previous frame, needs indirect_
+    std::optional<depth_pyramid> depth_pyramid_;
+    bool use_occlusion_ = true;
+    jobs::task_graph frame_graph_;
+    uint32_t frame_image_index_ = 0;
+    std::pmr::vector<draw_item> draw_list_{
+        {.index_count   = to_uint32_t(indices.size()),
+         .first_index   = 0,
+         .vertex_offset = 0,
+         .bounds        = {-.5f, -.5f, .5f, .5f}}
+    };
+    // draw_list_ bounds as flat boxes at their depth for the cpu culling of
+    // the direct path, rebuilt along with draw_list_
+    culling::box_set draw_bounds_;
+    std::vector<uint32_t> visible_draws_;
+    // draws are placed in normalized device coordinates, there's no camera
+    const culling::frustum view_frustum_ =
+        culling::extract_frustum(glm::mat4{1.f});
+    startup_timings startup_timings_;
+    frame_timings frame_timings_;
+    // vertices and indices as uploaded, after the mesh optimizer
+    std::vector<vertex> mesh_vertices_;
+    std::vector<uint16_t> mesh_indices_;
     VkBuffer vertex_buffer_;
-    VkDeviceMemory vertex_buffer_memory_;
+    memory_allocation vertex_buffer_memory_;
     VkBuffer index_buffer_;
-    VkDeviceMemory index_buffer_memory_;
+    memory_allocation index_buffer_memory_;
+    // replaced as a whole by set_instances, frames in flight keep reading
+    // the previous one
+    VkBuffer instance_buffer_ = VK_NULL_HANDLE;
+    memory_allocation instance_buffer_memory_;
+    // surface simulated on the cpu, each frame writes its own slot of the
+    // persistently mapped buffer while frames in flight read theirs
+    std::optional<ocean::simulation> ocean_;
+    VkBuffer ocean_buffer_ = VK_NULL_HANDLE;
+    memory_allocation ocean_buffer_memory_;
+    // surface simulated on the device and drawn instead of the scene
+    std::optional<gpu_ocean> gpu_ocean_;
+    // when the last simulation started, on either side
+    std::chrono::steady_clock::time_point ocean_start_;
     std::pmr::vector<VkCommandBuffer> command_buffers_;
+    // binary, the swap chain can't wait on or signal a timeline
     std::pmr::vector<VkSemaphore> image_available_samphores_;
     std::pmr::vector<VkSemaphore> render_finished_semaphores_;
-    std::pmr::vector<VkFence> in_flight_fences_;
+    // graphics queue timeline, the n-th submitted frame signals n
+    std::optional<timeline_semaphore> frame_timeline_;
+    // resources dropped mid-run, freed once frames in flight retired
+    std::optional<deletion_queue> deletions_;
     uint32_t current_frame_    = 0;
     bool frame_buffer_resized_ = false;
 
@@ -206,13 +373,15 @@ template<typename WindowT> class vk {
 
     inline auto get_required_extensions_()
     {
-        uint32_t glfw_extension_count = 0;
-        const char** glfw_extensions  = nullptr;
-        glfw_extensions               = glfwGetRequiredInstanceExtensions(
-            std::addressof(glfw_extension_count));
-        std::vector<const char*> extensions(glfw_extensions,
-                                            glfw_extensions
-                                                + glfw_extension_count);
+        std::vector<const char*> extensions;
+        if constexpr (not headless_) {
+            uint32_t glfw_extension_count = 0;
+            const char** glfw_extensions  = nullptr;
+            glfw_extensions               = glfwGetRequiredInstanceExtensions(
+                std::addressof(glfw_extension_count));
+            extensions.assign(glfw_extensions,
+                              glfw_extensions + glfw_extension_count);
+        }
         if (enable_validation_layers) {
             extensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
@@ -221,6 +390,7 @@ template<typename WindowT> class vk {
 
     inline auto setup_debug_messenger_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::setup_debug_messenger");
         if (not enable_validation_layers)
             return;
 
@@ -259,19 +429,49 @@ template<typename WindowT> class vk {
                 indices.graphics_family = static_cast<uint32_t>(i);
             }
             VkBool32 present_support = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(
-                device,
-                i,
-                surface_,
-                std::addressof(present_support));
+            if constexpr (headless_) {
+                // nothing is presented, the graphics queue "presents"
+                present_support = family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            }
+            else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(
+                    device,
+                    i,
+                    surface_,
+                    std::addressof(present_support));
+            }
             if (present_support) {
                 indices.present_family = static_cast<uint32_t>(i);
             }
+            // dedicated dma engines expose transfer without graphics/compute
+            const auto transfer_only =
+                (family.queueFlags & VK_QUEUE_TRANSFER_BIT)
+                and not(family.queueFlags
+                        & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+            if (transfer_only and not indices.transfer_family) {
+                indices.transfer_family = static_cast<uint32_t>(i);
+            }
         }
         return indices;
     }
 
+    static auto required_device_extensions_() -> std::span<const char* const>
+    {
+        if constexpr (headless_) {
+            return {};
+        }
+        else {
+            return device_extensions;
+        }
+    }
+
     inline auto check_device_extension_support_(VkPhysicalDevice device) const
+    {
+        return has_device_extensions_(device, required_device_extensions_());
+    }
+
+    inline auto has_device_extensions_(VkPhysicalDevice device,
+                                       std::span<const char* const> names) const
     {
         uint32_t extensions_count = 0;
         vkEnumerateDeviceExtensionProperties(device,
@@ -285,9 +485,8 @@ template<typename WindowT> class vk {
                                              std::addressof(extensions_count),
                                              available_extensions.data());
 
-        std::set<std::string_view> required_extensions(
-            std::begin(device_extensions),
-            std::end(device_extensions));
+        std::set<std::string_view> required_extensions(std::begin(names),
+                                                       std::end(names));
 
         for (const auto& ext : available_extensions) {
             required_extensions.erase(ext.extensionName);
@@ -333,13 +532,75 @@ template<typename WindowT> class vk {
         return details;
     }
 
+    inline auto check_timeline_semaphore_support_(VkPhysicalDevice device) const
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, std::addressof(properties));
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+        VkPhysicalDeviceVulkan12Features features_12{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES};
+        VkPhysicalDeviceFeatures2 features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = std::addressof(features_12)};
+        vkGetPhysicalDeviceFeatures2(device, std::addressof(features));
+        return equals(VK_TRUE, features_12.timelineSemaphore);
+    }
+
+    struct indirect_draw_support {
+        bool draws = false;
+        bool count = false;
+    };
+
+    inline auto check_indirect_draw_support_(VkPhysicalDevice device) const
+        -> indirect_draw_support
+    {
+        VkPhysicalDeviceVulkan12Features features_12{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES};
+        VkPhysicalDeviceFeatures2 features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = std::addressof(features_12)};
+        vkGetPhysicalDeviceFeatures2(device, std::addressof(features));
+        const auto draws =
+            equals(VK_TRUE, features.features.multiDrawIndirect)
+            and equals(VK_TRUE, features.features.drawIndirectFirstInstance);
+        return {.draws = draws,
+                .count =
+                    draws and equals(VK_TRUE, features_12.drawIndirectCount)};
+    }
+
+    // VK_KHR_present_wait together with the VK_KHR_present_id it builds on
+    inline auto check_present_wait_support_(VkPhysicalDevice device) const
+    {
+        if (headless_
+            or not has_device_extensions_(device, present_wait_extensions)) {
+            return false;
+        }
+        VkPhysicalDevicePresentWaitFeaturesKHR present_wait{
+            .sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+        VkPhysicalDevicePresentIdFeaturesKHR present_id{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = std::addressof(present_wait)};
+        VkPhysicalDeviceFeatures2 features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = std::addressof(present_id)};
+        vkGetPhysicalDeviceFeatures2(device, std::addressof(features));
+        return equals(VK_TRUE, present_id.presentId)
+               and equals(VK_TRUE, present_wait.presentWait);
+    }
+
     inline auto is_device_suitable_(VkPhysicalDevice device) const
     {
+        if (not check_timeline_semaphore_support_(device)) {
+            return false;
+        }
         auto indices = find_queue_families_(device);
         const auto extensions_supported =
             check_device_extension_support_(device);
-        auto swap_chain_adequate = false;
-        if (extensions_supported) {
+        auto swap_chain_adequate = headless_;
+        if (extensions_supported and not headless_) {
             auto swap_chain_support = query_swap_chain_support_(device);
             swap_chain_adequate =
                 (not swap_chain_support.formats.empty())
@@ -352,6 +613,7 @@ template<typename WindowT> class vk {
 
     inline auto pick_physical_device_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::pick_physical_device");
         uint32_t device_count = 0;
         vkEnumeratePhysicalDevices(instance_,
                                    std::addressof(device_count),
@@ -384,11 +646,13 @@ template<typename WindowT> class vk {
 
     void create_logical_device_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::create_logical_device");
         auto indices = find_queue_families_(physical_device_);
 
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
         std::set<uint32_t> unique_queue_families = {*indices.graphics_family,
-                                                    *indices.present_family};
+                                                    *indices.present_family,
+                                                    indices.upload_family()};
         auto queue_priority                      = 1.0f;
 
         for (uint32_t queue_family : unique_queue_families) {
@@ -401,16 +665,50 @@ template<typename WindowT> class vk {
             queue_create_infos.push_back(queue_create_info);
         }
 
-        VkPhysicalDeviceFeatures device_features{};
+        const auto present_wait =
+            check_present_wait_support_(physical_device_);
+        std::vector<const char*> extensions(
+            std::begin(required_device_extensions_()),
+            std::end(required_device_extensions_()));
+        if (present_wait) {
+            extensions.insert(std::end(extensions),
+                              std::begin(present_wait_extensions),
+                              std::end(present_wait_extensions));
+        }
+
+        const auto indirect = check_indirect_draw_support_(physical_device_);
+        indirect_supported_ = indirect.draws;
+        draw_indirect_count_ = indirect.count;
+        VkPhysicalDeviceFeatures device_features{
+            .multiDrawIndirect         = indirect.draws ? VK_TRUE : VK_FALSE,
+            .drawIndirectFirstInstance = indirect.draws ? VK_TRUE : VK_FALSE};
+        VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{
+            .sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+            .presentWait = VK_TRUE};
+        VkPhysicalDevicePresentIdFeaturesKHR present_id_features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = std::addressof(present_wait_features),
+            .presentId = VK_TRUE};
+        VkPhysicalDeviceVulkan12Features device_features_12{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES,
+            .pNext = present_wait ? std::addressof(present_id_features)
+                                  : nullptr,
+            .drawIndirectCount = indirect.count ? VK_TRUE : VK_FALSE,
+            // the staging ring resets its timestamp queries from the host,
+            // required of every 1.2 device
+            .hostQueryReset    = VK_TRUE,
+            .timelineSemaphore = VK_TRUE,
+        };
 
         VkDeviceCreateInfo create_info{
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+            .pNext = std::addressof(device_features_12),
             .queueCreateInfoCount =
                 static_cast<uint32_t>(queue_create_infos.size()),
-            .pQueueCreateInfos = queue_create_infos.data(),
-            .enabledExtensionCount =
-                static_cast<uint32_t>(device_extensions.size()),
-            .ppEnabledExtensionNames = device_extensions.data(),
+            .pQueueCreateInfos       = queue_create_infos.data(),
+            .enabledExtensionCount   = to_uint32_t(extensions.size()),
+            .ppEnabledExtensionNames = extensions.data(),
             .pEnabledFeatures        = std::addressof(device_features),
 
         };
@@ -439,22 +737,34 @@ template<typename WindowT> class vk {
                          indices.graphics_family.value(),
                          0,
                          std::addressof(present_queue_));
+        vkGetDeviceQueue(device_,
+                         indices.upload_family(),
+                         0,
+                         std::addressof(transfer_queue_));
+        if (present_wait) {
+            wait_for_present_ = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+                vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR"));
+        }
     }
 
     inline auto create_surface_()
     {
-        if (VK_SUCCESS
-            != glfwCreateWindowSurface(instance_,
-                                       window_.get(),
-                                       nullptr,
-                                       std::addressof(surface_))) {
-            throw std::runtime_error(
-                log_message("failed to create window surface!"));
+        ANTARTAR_PROFILE_ZONE("vk::create_surface");
+        if constexpr (not headless_) {
+            if (VK_SUCCESS
+                != glfwCreateWindowSurface(instance_,
+                                           window_.get(),
+                                           nullptr,
+                                           std::addressof(surface_))) {
+                throw std::runtime_error(
+                    log_message("failed to create window surface!"));
+            }
         }
     }
 
     inline auto create_vk_instance_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::create_vk_instance");
         if (enable_validation_layers && !check_validation_layer_support_()) {
             throw std::runtime_error(
                 log_message("validation layers requested, but not available!"));
@@ -466,7 +776,7 @@ template<typename WindowT> class vk {
         app_info.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
         app_info.pEngineName        = "no engine";
         app_info.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-        app_info.apiVersion         = VK_API_VERSION_1_0;
+        app_info.apiVersion         = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo create_info{};
         create_info.sType             = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -519,16 +829,7 @@ template<typename WindowT> class vk {
     inline VkPresentModeKHR choose_swap_present_mode_(
         const std::vector<VkPresentModeKHR>& available_present_modes) const
     {
-        auto mailbox_supported = [](const VkPresentModeKHR& mode) {
-            return VK_PRESENT_MODE_MAILBOX_KHR == mode;
-        };
-        if (auto mode =
-                ranges::find_if(available_present_modes, mailbox_supported);
-            mode != std::end(available_present_modes)) {
-            return *mode;
-        }
-        // this is always present
-        return VK_PRESENT_MODE_FIFO_KHR;
+        return choose_present_mode(pacing_, available_present_modes);
     }
 
     inline VkExtent2D
@@ -557,19 +858,65 @@ template<typename WindowT> class vk {
         }
     }
 
-    inline auto create_swap_chain_()
+    // one offscreen image per frame in flight, so frame slot and image index
+    // always match and the frame's timeline value also guards the image
+    inline auto create_offscreen_images_()
+        requires headless_
+    {
+        const VkExtent2D extent = window_.get().extent();
+        swap_chain_images_.resize(frames_in_flight_);
+        offscreen_memory_.resize(frames_in_flight_);
+        for (uint32_t i = 0; i < frames_in_flight_; ++i) {
+            auto& image = swap_chain_images_.at(i);
+            VkImageCreateInfo image_info{
+                .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .imageType   = VK_IMAGE_TYPE_2D,
+                .format      = offscreen_format,
+                .extent      = {extent.width, extent.height, 1},
+                .mipLevels   = 1,
+                .arrayLayers = 1,
+                .samples     = VK_SAMPLE_COUNT_1_BIT,
+                .tiling      = VK_IMAGE_TILING_OPTIMAL,
+                .usage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                         | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+            if (not equals(VK_SUCCESS,
+                           vkCreateImage(device_,
+                                         std::addressof(image_info),
+                                         nullptr,
+                                         std::addressof(image)))) {
+                throw std::runtime_error(
+                    log_message("failed to create offscreen image!"sv));
+            }
+            VkMemoryRequirements memory_requirements;
+            vkGetImageMemoryRequirements(device_,
+                                         image,
+                                         std::addressof(memory_requirements));
+            auto& memory = offscreen_memory_.at(i);
+            memory       = allocator_->allocate(memory_requirements,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            vkBindImageMemory(device_, image, memory.memory, memory.offset);
+        }
+        swap_chain_image_format_ = offscreen_format;
+        swap_chain_extent_       = extent;
+    }
+
+    inline auto create_surface_swap_chain_()
+        requires(not headless_)
     {
         auto swap_chain_support = query_swap_chain_support_(physical_device_);
 
         auto surface_format =
             choose_swap_surface_format_(swap_chain_support.formats);
-        auto present_mode =
+        present_mode_ =
             choose_swap_present_mode_(swap_chain_support.present_modes);
         auto extent =
             choose_swap_extent_(swap_chain_support.capabilities, window_.get());
 
-        // minimum + one more so we dont wait on the driver
-        auto image_count = swap_chain_support.capabilities.minImageCount + 1;
+        // extra images keep the cpu from waiting on the presentation engine
+        auto image_count = swap_chain_support.capabilities.minImageCount
+                           + pacing_.extra_images;
         // make sure we don't exceed maxImageCount, where 0 means it's unbounded
         if (swap_chain_support.capabilities.maxImageCount > 0
             && image_count > swap_chain_support.capabilities.maxImageCount) {
@@ -603,9 +950,11 @@ template<typename WindowT> class vk {
         create_info.preTransform =
             swap_chain_support.capabilities.currentTransform;
         create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        create_info.presentMode    = present_mode;
+        create_info.presentMode    = present_mode_;
         create_info.clipped        = VK_TRUE;
-        create_info.oldSwapchain   = VK_NULL_HANDLE;
+        // lets the driver hand over resources, images the old swap chain
+        // hasn't given out are released right away
+        create_info.oldSwapchain = swap_chain_;
 
         if (VK_SUCCESS
             != vkCreateSwapchainKHR(device_,
@@ -629,8 +978,20 @@ template<typename WindowT> class vk {
         swap_chain_extent_       = extent;
     }
 
+    inline auto create_swap_chain_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_swap_chain");
+        if constexpr (headless_) {
+            create_offscreen_images_();
+        }
+        else {
+            create_surface_swap_chain_();
+        }
+    }
+
     inline auto create_image_views_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::create_image_views");
         swap_chain_image_views_.resize(swap_chain_images_.size());
         for (const auto& [i, image] :
              swap_chain_images_ | ranges::views::enumerate) {
@@ -661,12 +1022,92 @@ template<typename WindowT> class vk {
         }
     }
 
-    inline VkShaderModule create_shader_module_(const auto& code)
+    // the depth pyramid samples the depth buffer, so it has to be both
+    inline auto choose_depth_format_() const
+    {
+        constexpr VkFormatFeatureFlags features =
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+            | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        for (auto format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM}) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(
+                physical_device_, format, std::addressof(properties));
+            if ((properties.optimalTilingFeatures & features) == features) {
+                return format;
+            }
+        }
+        throw std::runtime_error(
+            log_message("failed to find a sampleable depth format!"sv));
+    }
+
+    inline auto create_depth_resources_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_depth_resources");
+        if (depth_format_ == VK_FORMAT_UNDEFINED) {
+            depth_format_ = choose_depth_format_();
+        }
+        VkImageCreateInfo image_info{
+            .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType   = VK_IMAGE_TYPE_2D,
+            .format      = depth_format_,
+            .extent      = {swap_chain_extent_.width,
+                            swap_chain_extent_.height,
+                            1},
+            .mipLevels   = 1,
+            .arrayLayers = 1,
+            .samples     = VK_SAMPLE_COUNT_1_BIT,
+            .tiling      = VK_IMAGE_TILING_OPTIMAL,
+            .usage       = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                     | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+        if (not equals(VK_SUCCESS,
+                       vkCreateImage(device_,
+                                     std::addressof(image_info),
+                                     nullptr,
+                                     std::addressof(depth_image_)))) {
+            throw std::runtime_error(
+                log_message("failed to create depth image!"sv));
+        }
+        VkMemoryRequirements memory_requirements;
+        vkGetImageMemoryRequirements(device_,
+                                     depth_image_,
+                                     std::addressof(memory_requirements));
+        depth_image_memory_ = allocator_->allocate(
+            memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkBindImageMemory(device_,
+                          depth_image_,
+                          depth_image_memory_.memory,
+                          depth_image_memory_.offset);
+        VkImageViewCreateInfo view_info{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image            = depth_image_,
+            .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+            .format           = depth_format_,
+            .subresourceRange = {.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
+                                 .baseMipLevel   = 0,
+                                 .levelCount     = 1,
+                                 .baseArrayLayer = 0,
+                                 .layerCount     = 1}
+        };
+        if (not equals(VK_SUCCESS,
+                       vkCreateImageView(device_,
+                                         std::addressof(view_info),
+                                         nullptr,
+                                         std::addressof(depth_image_view_)))) {
+            throw std::runtime_error(
+                log_message("failed to create depth image view!"sv));
+        }
+        depth_history_ = false;
+    }
+
+    inline VkShaderModule
+    create_shader_module_(std::span<const std::byte> code)
     {
         VkShaderModuleCreateInfo create_info{};
         create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = code->size();
-        create_info.pCode    = reinterpret_cast<const uint32_t*>(code->data());
+        create_info.codeSize = code.size();
+        create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
 
         VkShaderModule shader_module;
         if (VK_SUCCESS
@@ -679,14 +1120,24 @@ template<typename WindowT> class vk {
         return shader_module;
     }
 
+    // spir-v goes to the driver straight from the file mapping
+    inline auto load_shader_module_(std::string_view name)
+    {
+        auto code =
+            file::map(file::path::join(ANTARTAR_SHADERS_DIRECTORY, name),
+                      file::access_pattern::sequential);
+        if (not code) {
+            throw std::runtime_error(
+                log_message(fmt::format("failed to open shader {}", name)));
+        }
+        return create_shader_module_(code->bytes());
+    }
+
     inline auto create_graphics_pipeline_()
     {
-        auto vert_shader_code = file::read(
-            file::path::join(ANTARTAR_SHADERS_DIRECTORY, "shader.vert.spv"));
-        auto vert_shader_module = create_shader_module_(vert_shader_code);
-        auto frag_shader_code   = file::read(
-            file::path::join(ANTARTAR_SHADERS_DIRECTORY, "shader.frag.spv"));
-        auto frag_shader_module = create_shader_module_(frag_shader_code);
+        ANTARTAR_PROFILE_ZONE("vk::create_graphics_pipeline");
+        auto vert_shader_module = load_shader_module_("shader.vert.spv");
+        auto frag_shader_module = load_shader_module_("shader.frag.spv");
 
         VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
         vert_shader_stage_info.sType =
@@ -705,12 +1156,15 @@ template<typename WindowT> class vk {
         std::array shader_stages = {vert_shader_stage_info,
                                     frag_shader_stage_info};
 
-        auto binding_description    = vertex::get_binding_description();
-        auto attribute_descriptions = vertex::get_attribute_descriptions();
+        const auto binding_descriptions =
+            vertex_input_bindings<vertex, instance>();
+        const auto attribute_descriptions =
+            vertex_input_attributes<vertex, instance>();
         VkPipelineVertexInputStateCreateInfo vertex_input_info{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-            .vertexBindingDescriptionCount = 1u,
-            .pVertexBindingDescriptions = std::addressof(binding_description),
+            .vertexBindingDescriptionCount =
+                to_uint32_t(binding_descriptions.size()),
+            .pVertexBindingDescriptions = binding_descriptions.data(),
             .vertexAttributeDescriptionCount =
                 to_uint32_t(attribute_descriptions.size()),
             .pVertexAttributeDescriptions = attribute_descriptions.data(),
@@ -773,6 +1227,15 @@ template<typename WindowT> class vk {
         color_blending.pAttachments    = std::addressof(color_blend_attachment);
         ranges::fill(color_blending.blendConstants, 0.f);
 
+        VkPipelineDepthStencilStateCreateInfo depth_stencil{
+            .sType =
+                VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .depthTestEnable  = VK_TRUE,
+            .depthWriteEnable = VK_TRUE,
+            .depthCompareOp   = VK_COMPARE_OP_LESS,
+            .minDepthBounds   = 0.f,
+            .maxDepthBounds   = 1.f};
+
         std::array dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT,
                                      VK_DYNAMIC_STATE_SCISSOR,
                                      VK_DYNAMIC_STATE_LINE_WIDTH};
@@ -809,7 +1272,7 @@ template<typename WindowT> class vk {
         pipeline_info.pViewportState      = std::addressof(viewport_state);
         pipeline_info.pRasterizationState = std::addressof(rasterizer);
         pipeline_info.pMultisampleState   = std::addressof(multisampling);
-        pipeline_info.pDepthStencilState  = nullptr;
+        pipeline_info.pDepthStencilState  = std::addressof(depth_stencil);
         pipeline_info.pColorBlendState    = std::addressof(color_blending);
         pipeline_info.pDynamicState       = std::addressof(dynamic_state);
         pipeline_info.layout              = pipeline_layout_;
@@ -821,7 +1284,7 @@ template<typename WindowT> class vk {
         if (not equals(VK_SUCCESS,
                        vkCreateGraphicsPipelines(
                            device_,
-                           VK_NULL_HANDLE,
+                           pipeline_cache_->handle(),
                            1,
                            std::addressof(pipeline_info),
                            nullptr,
@@ -835,6 +1298,7 @@ template<typename WindowT> class vk {
 
     auto create_render_pass_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::create_render_pass");
         VkAttachmentDescription color_attachment{};
         color_attachment.format         = swap_chain_image_format_;
         color_attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
@@ -843,34 +1307,70 @@ template<typename WindowT> class vk {
         color_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         color_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-        color_attachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // offscreen images stay ready to be copied out
+        color_attachment.finalLayout =
+            headless_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                      : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        // left for the next frame's depth pyramid to sample
+        VkAttachmentDescription depth_attachment{
+            .format         = depth_format_,
+            .samples        = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
         VkAttachmentReference color_attachment_ref{};
         color_attachment_ref.attachment = 0;
         color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkAttachmentReference depth_attachment_ref{
+            .attachment = 1,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
 
         VkSubpassDescription subpass{};
         subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments    = std::addressof(color_attachment_ref);
-
-        VkSubpassDependency dependency{
-            .srcSubpass    = VK_SUBPASS_EXTERNAL,
-            .dstSubpass    = 0,
-            .srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        subpass.pDepthStencilAttachment = std::addressof(depth_attachment_ref);
+
+        // the depth buffer is cleared only after the previous frame wrote it
+        // and the depth pyramid read it, and read again once written
+        std::array dependencies = {
+            VkSubpassDependency{
+                .srcSubpass   = VK_SUBPASS_EXTERNAL,
+                .dstSubpass   = 0,
+                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+                                | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            },
+            VkSubpassDependency{
+                .srcSubpass    = 0,
+                .dstSubpass    = VK_SUBPASS_EXTERNAL,
+                .srcStageMask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .dstStageMask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            },
         };
 
+        std::array attachments = {color_attachment, depth_attachment};
         VkRenderPassCreateInfo render_pass_info{};
         render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        render_pass_info.attachmentCount = 1;
-        render_pass_info.pAttachments    = std::addressof(color_attachment);
+        render_pass_info.attachmentCount = to_uint32_t(attachments.size());
+        render_pass_info.pAttachments    = attachments.data();
         render_pass_info.subpassCount    = 1;
         render_pass_info.pSubpasses      = std::addressof(subpass);
-        render_pass_info.dependencyCount = 1;
-        render_pass_info.pDependencies   = std::addressof(dependency);
+        render_pass_info.dependencyCount = to_uint32_t(dependencies.size());
+        render_pass_info.pDependencies   = dependencies.data();
 
         if (not equals(VK_SUCCESS,
                        vkCreateRenderPass(device_,
@@ -883,14 +1383,16 @@ template<typename WindowT> class vk {
 
     auto create_framebuffers_()
     {
+        ANTARTAR_PROFILE_ZONE("vk::create_framebuffers");
         swap_chain_framebuffers_.resize(swap_chain_image_views_.size());
         for (auto [i, swap_chain_image_view] :
              ranges::views::enumerate(swap_chain_image_views_)) {
-            std::array attachments = {swap_chain_image_view};
+            std::array attachments = {swap_chain_image_view,
+                                      depth_image_view_};
             VkFramebufferCreateInfo framebuffer_info{};
             framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebuffer_info.renderPass      = render_pass_;
-            framebuffer_info.attachmentCount = 1;
+            framebuffer_info.attachmentCount = to_uint32_t(attachments.size());
             framebuffer_info.pAttachments    = attachments.data();
             framebuffer_info.width           = swap_chain_extent_.width;
             framebuffer_info.height          = swap_chain_extent_.height;
@@ -909,6 +1411,7 @@ template<typename WindowT> class vk {
 
     auto create_command_pool_() -> void
     {
+        ANTARTAR_PROFILE_ZONE("vk::create_command_pool");
         queue_family_indices queue_family_indices =
             find_queue_families_(physical_device_);
         VkCommandPoolCreateInfo pool_info{};
@@ -927,7 +1430,8 @@ template<typename WindowT> class vk {
 
     auto create_command_buffers_()
     {
-        command_buffers_.resize(max_frames_in_flight);
+        ANTARTAR_PROFILE_ZONE("vk::create_command_buffers");
+        command_buffers_.resize(frames_in_flight_);
         VkCommandBufferAllocateInfo alloc_info{
             .sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
             .commandPool = command_pool_,
@@ -942,34 +1446,10 @@ template<typename WindowT> class vk {
         }
     }
 
-    auto record_command_buffer_(VkCommandBuffer command_buffer,
-                                uint32_t image_index)
+    // secondary command buffers inherit nothing but the render pass, every
+    // one of them binds the whole state again
+    auto bind_draw_state_(VkCommandBuffer command_buffer)
     {
-        VkCommandBufferBeginInfo begin_info{
-            .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .flags            = 0,
-            .pInheritanceInfo = nullptr};
-        if (not equals(VK_SUCCESS,
-                       vkBeginCommandBuffer(command_buffer,
-                                            std::addressof(begin_info)))) {
-            throw std::runtime_error(
-                "failed to begin recording command buffer!");
-        }
-
-        VkClearValue clear_color = {{{0.f, 0.f, 0.f, 1.f}}};
-
-        VkRenderPassBeginInfo render_pass_info{
-            .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .renderPass      = render_pass_,
-            .framebuffer     = swap_chain_framebuffers_.at(image_index),
-            .renderArea      = {.offset = {0, 0}, .extent = swap_chain_extent_},
-            .clearValueCount = 1,
-            .pClearValues    = std::addressof(clear_color),
-        };
-
-        vkCmdBeginRenderPass(command_buffer,
-                             std::addressof(render_pass_info),
-                             VK_SUBPASS_CONTENTS_INLINE);
         vkCmdBindPipeline(command_buffer,
                           VK_PIPELINE_BIND_POINT_GRAPHICS,
                           graphics_pipeline_);
@@ -989,34 +1469,311 @@ template<typename WindowT> class vk {
         };
         vkCmdSetScissor(command_buffer, 0, 1, std::addressof(scissor));
 
-        VkBuffer vertex_buffers[] = {vertex_buffer_};
-        VkDeviceSize offsets[]    = {0};
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+        VkBuffer vertex_buffers[] = {vertex_buffer_, instance_buffer_};
+        VkDeviceSize offsets[]    = {0, 0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
         vkCmdBindIndexBuffer(command_buffer,
                              index_buffer_,
                              0,
                              VK_INDEX_TYPE_UINT16);
+    }
+
+    auto record_draws_(VkCommandBuffer command_buffer,
+                       std::span<const uint32_t> visible)
+    {
+        for (const auto i : visible) {
+            const auto& draw = draw_list_[i];
+            vkCmdDrawIndexed(command_buffer,
+                             draw.index_count,
+                             draw.instance_count,
+                             draw.first_index,
+                             draw.vertex_offset,
+                             draw.first_instance);
+        }
+    }
+
+    auto record_command_buffer_(VkCommandBuffer command_buffer,
+                                uint32_t image_index)
+    {
+        VkCommandBufferBeginInfo begin_info{
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags            = 0,
+            .pInheritanceInfo = nullptr};
+        if (not equals(VK_SUCCESS,
+                       vkBeginCommandBuffer(command_buffer,
+                                            std::addressof(begin_info)))) {
+            throw std::runtime_error(
+                "failed to begin recording command buffer!");
+        }
+        std::optional<uint32_t> render_pass_zone;
+        if (gpu_profiler_) {
+            gpu_profiler_->begin_frame(command_buffer, current_frame_);
+        }
+        // the gpu ocean replaces the scene, nothing to cull
+        const auto indirect = draws_indirect() and not gpu_ocean_;
+        if (gpu_ocean_) {
+            std::optional<uint32_t> ocean_zone;
+            if (gpu_profiler_) {
+                ocean_zone =
+                    gpu_profiler_->begin_zone(command_buffer, "ocean"sv);
+            }
+            gpu_ocean_->record(command_buffer, ocean_seconds_());
+            if (gpu_profiler_) {
+                gpu_profiler_->end_zone(command_buffer, ocean_zone);
+            }
+        }
+        else if (indirect) {
+            // without occlusion culling the pyramid is only made bindable
+            const auto occlusion = use_occlusion_ and depth_history_;
+            std::optional<uint32_t> depth_pyramid_zone;
+            if (gpu_profiler_) {
+                depth_pyramid_zone = gpu_profiler_->begin_zone(
+                    command_buffer, "depth_pyramid"sv);
+            }
+            depth_pyramid_->build(command_buffer,
+                                  current_frame_,
+                                  occlusion ? depth_image_view_
+                                            : VK_NULL_HANDLE);
+            if (gpu_profiler_) {
+                gpu_profiler_->end_zone(command_buffer, depth_pyramid_zone);
+            }
+            std::optional<uint32_t> draw_commands_zone;
+            if (gpu_profiler_) {
+                draw_commands_zone = gpu_profiler_->begin_zone(
+                    command_buffer, "draw_commands"sv);
+            }
+            indirect_->build(
+                command_buffer, current_frame_, *depth_pyramid_, occlusion);
+            if (gpu_profiler_) {
+                gpu_profiler_->end_zone(command_buffer, draw_commands_zone);
+            }
+        }
+        if (gpu_profiler_) {
+            render_pass_zone =
+                gpu_profiler_->begin_zone(command_buffer, "render_pass"sv);
+        }
+
+        std::array<VkClearValue, 2> clear_values{};
+        clear_values[0].color        = {{0.f, 0.f, 0.f, 1.f}};
+        clear_values[1].depthStencil = {.depth = 1.f, .stencil = 0};
 
-        vkCmdDrawIndexed(command_buffer, to_uint32_t(indices.size()), 1, 0, 0, 0);
+        VkRenderPassBeginInfo render_pass_info{
+            .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass      = render_pass_,
+            .framebuffer     = swap_chain_framebuffers_.at(image_index),
+            .renderArea      = {.offset = {0, 0}, .extent = swap_chain_extent_},
+            .clearValueCount = to_uint32_t(clear_values.size()),
+            .pClearValues    = clear_values.data(),
+        };
+
+        // the gpu writes the commands, recording doesn't depend on the draw
+        // count; otherwise long draw lists are split across threads into
+        // secondary command buffers, short ones aren't worth the
+        // vkCmdExecuteCommands
+        if (gpu_ocean_) {
+            vkCmdBeginRenderPass(command_buffer,
+                                 std::addressof(render_pass_info),
+                                 VK_SUBPASS_CONTENTS_INLINE);
+            gpu_ocean_->draw(command_buffer,
+                             current_frame_,
+                             swap_chain_extent_,
+                             ocean_view_projection_(),
+                             ocean_eye_());
+        }
+        else if (indirect) {
+            vkCmdBeginRenderPass(command_buffer,
+                                 std::addressof(render_pass_info),
+                                 VK_SUBPASS_CONTENTS_INLINE);
+            bind_draw_state_(command_buffer);
+            indirect_->draw(command_buffer);
+        }
+        else if (recorder_->slices_for(visible_draws_.size()) > 1) {
+            vkCmdBeginRenderPass(
+                command_buffer,
+                std::addressof(render_pass_info),
+                VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            VkCommandBufferInheritanceInfo inheritance{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+                .renderPass  = render_pass_,
+                .subpass     = 0,
+                .framebuffer = swap_chain_framebuffers_.at(image_index)};
+            const auto secondaries = recorder_->record(
+                current_frame_,
+                inheritance,
+                visible_draws_.size(),
+                [this](VkCommandBuffer secondary, size_t first, size_t last) {
+                    bind_draw_state_(secondary);
+                    record_draws_(secondary,
+                                  std::span{visible_draws_}.subspan(
+                                      first, last - first));
+                });
+            vkCmdExecuteCommands(command_buffer,
+                                 to_uint32_t(secondaries.size()),
+                                 secondaries.data());
+        }
+        else {
+            vkCmdBeginRenderPass(command_buffer,
+                                 std::addressof(render_pass_info),
+                                 VK_SUBPASS_CONTENTS_INLINE);
+            bind_draw_state_(command_buffer);
+            record_draws_(command_buffer, visible_draws_);
+        }
         vkCmdEndRenderPass(command_buffer);
+        depth_history_ = true;
+        if (gpu_profiler_) {
+            gpu_profiler_->end_zone(command_buffer, render_pass_zone);
+        }
+        if constexpr (headless_) {
+            if (window_.get().readback()) {
+                std::optional<uint32_t> readback_zone;
+                if (gpu_profiler_) {
+                    readback_zone =
+                        gpu_profiler_->begin_zone(command_buffer, "readback"sv);
+                }
+                record_readback_(command_buffer, image_index);
+                if (gpu_profiler_) {
+                    gpu_profiler_->end_zone(command_buffer, readback_zone);
+                }
+            }
+        }
         if (not equals(VK_SUCCESS, vkEndCommandBuffer(command_buffer))) {
             throw std::runtime_error("failed to record command buffer!");
         }
     }
 
+    // a fixed eye a little above the gpu ocean, looking out to its horizon
+    auto ocean_eye_() const
+    {
+        return glm::vec3{0.f, .08f, 0.f} * gpu_ocean_->patch_length();
+    }
+
+    auto ocean_view_projection_() const
+    {
+        const auto length = gpu_ocean_->patch_length();
+        const auto aspect = static_cast<float>(swap_chain_extent_.width)
+                            / static_cast<float>(swap_chain_extent_.height);
+        auto projection   = glm::perspectiveRH_ZO(
+            glm::radians(50.f), aspect, 1.f, gpu_ocean_->horizon());
+        // vulkan's clip space y points down
+        projection[1][1] *= -1.f;
+        const auto view = glm::lookAtRH(ocean_eye_(),
+                                        glm::vec3{0.f, 0.f, -.6f} * length,
+                                        glm::vec3{0.f, 1.f, 0.f});
+        return projection * view;
+    }
+
+    auto record_readback_(VkCommandBuffer command_buffer, uint32_t image_index)
+    {
+        const auto image = swap_chain_images_.at(image_index);
+        VkImageMemoryBarrier rendered{
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    .levelCount = 1,
+                                    .layerCount = 1}};
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             1,
+                             std::addressof(rendered));
+
+        const auto buffer = readback_buffers_.at(image_index);
+        VkBufferImageCopy region{
+            .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                 .layerCount = 1},
+            .imageExtent      = {swap_chain_extent_.width,
+                                 swap_chain_extent_.height,
+                                 1}
+        };
+        vkCmdCopyImageToBuffer(command_buffer,
+                               image,
+                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               buffer,
+                               1,
+                               std::addressof(region));
+
+        VkBufferMemoryBarrier copied{
+            .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer              = buffer,
+            .size                = VK_WHOLE_SIZE};
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_HOST_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             std::addressof(copied),
+                             0,
+                             nullptr);
+    }
+
+    auto create_readback_buffers_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_readback_buffers");
+        if constexpr (headless_) {
+            if (not window_.get().readback()) {
+                return;
+            }
+            const VkDeviceSize size = VkDeviceSize{swap_chain_extent_.width}
+                                      * swap_chain_extent_.height * 4;
+            readback_buffers_.resize(frames_in_flight_);
+            readback_memory_.resize(frames_in_flight_);
+            for (uint32_t i = 0; i < frames_in_flight_; ++i) {
+                create_buffer_(size,
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                   | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               readback_buffers_.at(i),
+                               readback_memory_.at(i));
+            }
+        }
+    }
+
+    // hands a finished frame to the window, the frame's timeline value
+    // must be reached
+    auto present_readback_(uint32_t frame)
+        requires headless_
+    {
+        if (not readback_pending_.at(frame)) {
+            return;
+        }
+        readback_pending_.at(frame) = false;
+        const auto& memory          = readback_memory_.at(frame);
+        window_.get().present(std::span{
+            static_cast<const std::byte*>(memory.mapped),
+            static_cast<size_t>(VkDeviceSize{swap_chain_extent_.width}
+                                * swap_chain_extent_.height * 4)});
+    }
+
     auto create_sync_objects_()
     {
-        image_available_samphores_.resize(max_frames_in_flight);
-        render_finished_semaphores_.resize(max_frames_in_flight);
-        in_flight_fences_.resize(max_frames_in_flight);
+        ANTARTAR_PROFILE_ZONE("vk::create_sync_objects");
+        frame_timeline_.emplace(device_);
+        if constexpr (headless_) {
+            return;
+        }
+        image_available_samphores_.resize(frames_in_flight_);
+        render_finished_semaphores_.resize(frames_in_flight_);
         VkSemaphoreCreateInfo semaphore_info{
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
         };
-        VkFenceCreateInfo fence_info{
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-        };
-        for (int i = 0; i < max_frames_in_flight; ++i) {
+        for (uint32_t i = 0; i < frames_in_flight_; ++i) {
             if (not equals(
                     VK_SUCCESS,
                     vkCreateSemaphore(
@@ -1030,18 +1787,76 @@ template<typename WindowT> class vk {
                         device_,
                         std::addressof(semaphore_info),
                         nullptr,
-                        std::addressof(render_finished_semaphores_.at(i))))
-                || not equals(
-                    VK_SUCCESS,
-                    vkCreateFence(device_,
-                                  std::addressof(fence_info),
-                                  nullptr,
-                                  std::addressof(in_flight_fences_.at(i))))) {
+                        std::addressof(render_finished_semaphores_.at(i))))) {
                 throw std::runtime_error("failed to create semaphores!");
             }
         }
     }
 
+    auto create_deletion_queue_()
+    {
+        deletions_.emplace(device_, *allocator_, *frame_timeline_);
+    }
+
+    auto create_indirect_draws_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_indirect_draws");
+        if (not indirect_supported_) {
+            log<severity::warning>(
+                "no multi draw indirect, draws are recorded on the cpu"sv);
+            return;
+        }
+        auto reduce_shader = load_shader_module_("depth_pyramid.comp.spv");
+        depth_pyramid_.emplace(device_,
+                               *allocator_,
+                               *deletions_,
+                               pipeline_cache_->handle(),
+                               reduce_shader,
+                               frames_in_flight_,
+                               swap_chain_extent_);
+        vkDestroyShaderModule(device_, reduce_shader, nullptr);
+        auto shader = load_shader_module_("draw_commands.comp.spv");
+        indirect_.emplace(device_,
+                          *allocator_,
+                          *deletions_,
+                          pipeline_cache_->handle(),
+                          shader,
+                          frames_in_flight_,
+                          draw_indirect_count_);
+        vkDestroyShaderModule(device_, shader, nullptr);
+        upload_indirect_draws_();
+    }
+
+    // the gpu copy of draw_list_
+    auto upload_indirect_draws_()
+    {
+        if (not indirect_) {
+            return;
+        }
+        std::vector<indirect_draw> draws;
+        draws.reserve(draw_list_.size());
+        for (const auto& draw : draw_list_) {
+            draws.push_back({.command = {.indexCount    = draw.index_count,
+                                         .instanceCount = draw.instance_count,
+                                         .firstIndex    = draw.first_index,
+                                         .vertexOffset  = draw.vertex_offset,
+                                         .firstInstance = draw.first_instance},
+                             .depth   = draw.depth,
+                             .bounds  = draw.bounds});
+        }
+        indirect_->upload(*staging_, draws);
+    }
+
+    // the next frame reuses the command buffer, pools and queries of the frame
+    // frames_in_flight_ submits back
+    auto wait_for_frame_slot_()
+    {
+        const auto next_frame = frame_timeline_->last_reserved() + 1;
+        if (next_frame > frames_in_flight_) {
+            frame_timeline_->wait(next_frame - frames_in_flight_);
+        }
+    }
+
     void cleanup_swap_chain_()
     {
         ranges::for_each(
@@ -1049,15 +1864,29 @@ template<typename WindowT> class vk {
             [this](VkFramebuffer framebuffer) {
                 vkDestroyFramebuffer(device_, framebuffer, nullptr);
             });
+        vkDestroyImageView(device_, depth_image_view_, nullptr);
+        vkDestroyImage(device_, depth_image_, nullptr);
+        allocator_->free(depth_image_memory_);
         ranges::for_each(swap_chain_image_views_,
                          [this](const VkImageView& image_view) {
                              vkDestroyImageView(device_, image_view, nullptr);
                          });
-        vkDestroySwapchainKHR(device_, swap_chain_, nullptr);
+        if constexpr (headless_) {
+            for (const auto& [i, image] :
+                 swap_chain_images_ | ranges::views::enumerate) {
+                vkDestroyImage(device_, image, nullptr);
+                allocator_->free(offscreen_memory_.at(i));
+            }
+        }
+        else {
+            vkDestroySwapchainKHR(device_, swap_chain_, nullptr);
+        }
     }
 
     void recreate_swap_chain_()
+        requires(not headless_)
     {
+        ANTARTAR_PROFILE_ZONE("vk::recreate_swap_chain");
         int width = 0, height = 0;
         glfwGetFramebufferSize(window_.get(),
                                std::addressof(width),
@@ -1068,39 +1897,79 @@ template<typename WindowT> class vk {
                                    std::addressof(height));
             glfwWaitEvents();
         }
-        vkDeviceWaitIdle(device_);
-
-        cleanup_swap_chain_();
+        // frames in flight still render to and present the old images, so
+        // instead of draining the gpu the old objects wait for those frames
+        ranges::for_each(swap_chain_framebuffers_,
+                         [this](VkFramebuffer f) { deletions_->retire(f); });
+        ranges::for_each(swap_chain_image_views_,
+                         [this](VkImageView v) { deletions_->retire(v); });
+        deletions_->retire(
+            depth_image_view_, depth_image_, depth_image_memory_);
+        const auto old_swap_chain = swap_chain_;
 
         create_swap_chain_();
+        deletions_->retire(old_swap_chain);
         create_image_views_();
+        create_depth_resources_();
+        if (depth_pyramid_) {
+            depth_pyramid_->resize(swap_chain_extent_);
+        }
         create_framebuffers_();
+        // pending present ids belong to the destroyed swap chain
+        oldest_unseen_present_ = next_present_id_;
     }
 
-    uint32_t find_memory_type_(uint32_t type_filter,
-                               VkMemoryPropertyFlags properties)
+    // present ids complete in order, the first one not on screen yet ends the
+    // scan; ids up to wait_until are waited for, later ones only polled, so
+    // their latency is observed up to a frame late
+    auto collect_presents_(uint64_t wait_until)
+        requires(not headless_)
     {
-        VkPhysicalDeviceMemoryProperties memory_properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device_,
-                                            std::addressof(memory_properties));
-
-        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
-            if ((type_filter & (1 << i))
-                and ((memory_properties.memoryTypes[i].propertyFlags
-                      & properties)
-                     == properties)) {
-                return i;
+        if (wait_for_present_ == nullptr) {
+            return;
+        }
+        if (next_present_id_ > tracked_presents) {
+            oldest_unseen_present_ = std::max(
+                oldest_unseen_present_, next_present_id_ - tracked_presents);
+        }
+        for (; oldest_unseen_present_ < next_present_id_;
+             ++oldest_unseen_present_) {
+            const auto id = oldest_unseen_present_;
+            const auto result =
+                wait_for_present_(device_,
+                                  swap_chain_,
+                                  id,
+                                  id <= wait_until ? present_wait_timeout_ns
+                                                   : 0);
+            if (not one_of(result, VK_SUCCESS, VK_SUBOPTIMAL_KHR)) {
+                return;
             }
+            frame_timings_.input_to_present =
+                std::chrono::steady_clock::now()
+                - present_starts_.at(id % tracked_presents);
         }
+    }
+
+    auto create_memory_allocator_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_memory_allocator");
+        allocator_.emplace(physical_device_, device_);
+    }
 
-        throw std::runtime_error("failed to find suitable memory type!");
+    auto create_pipeline_cache_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_pipeline_cache");
+        pipeline_cache_.emplace(
+            physical_device_,
+            device_,
+            file::path::join(ANTARTAR_SHADERS_DIRECTORY, "pipeline.cache"));
     }
 
     auto create_buffer_(VkDeviceSize size,
                         VkBufferUsageFlags usage,
                         VkMemoryPropertyFlags properties,
                         VkBuffer& buffer,
-                        VkDeviceMemory& buffer_memory)
+                        memory_allocation& buffer_memory)
     {
         VkBufferCreateInfo buffer_info{
             .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -1120,90 +1989,159 @@ template<typename WindowT> class vk {
                                       buffer,
                                       std::addressof(memory_requirements));
 
-        VkMemoryAllocateInfo alloc_info{
-            .sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = memory_requirements.size,
-            .memoryTypeIndex =
-                find_memory_type_(memory_requirements.memoryTypeBits,
-                                  properties)};
+        buffer_memory = allocator_->allocate(memory_requirements, properties);
+        vkBindBufferMemory(device_,
+                           buffer,
+                           buffer_memory.memory,
+                           buffer_memory.offset);
+    }
 
-        if (not equals(VK_SUCCESS,
-                       vkAllocateMemory(device_,
-                                        std::addressof(alloc_info),
-                                        nullptr,
-                                        std::addressof(buffer_memory)))) {
-            throw std::runtime_error("failed to allocate buffer memory!");
+    auto destroy_buffer_(VkBuffer buffer, memory_allocation& buffer_memory)
+    {
+        vkDestroyBuffer(device_, buffer, nullptr);
+        allocator_->free(buffer_memory);
+    }
+
+    auto create_staging_ring_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_staging_ring");
+        auto indices = find_queue_families_(physical_device_);
+        staging_.emplace(
+            device_,
+            *allocator_,
+            queue_endpoint{.family = indices.upload_family(),
+                           .queue  = transfer_queue_},
+            queue_endpoint{.family = indices.graphics_family.value(),
+                           .queue  = graphics_queue_},
+            query_timestamp_properties(physical_device_,
+                                       indices.upload_family()));
+        if (indices.transfer_family) {
+            log("uploading through dedicated transfer family {}",
+                *indices.transfer_family);
         }
-        vkBindBufferMemory(device_, buffer, buffer_memory, 0);
     }
 
-    auto
-    copy_buffer_(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size)
+    auto create_gpu_profiler_()
     {
-        VkCommandBufferAllocateInfo alloc_info{
-            .sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .commandPool = command_pool_,
-            .level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            .commandBufferCount = 1,
-        };
+        ANTARTAR_PROFILE_ZONE("vk::create_gpu_profiler");
+        auto indices    = find_queue_families_(physical_device_);
+        auto timestamps = query_timestamp_properties(
+            physical_device_,
+            indices.graphics_family.value());
+        if (not timestamps) {
+            log<severity::warning>(
+                "graphics queue can't write timestamps, no gpu profiling"sv);
+            return;
+        }
+        gpu_profiler_.emplace(device_, *timestamps, frames_in_flight_);
+    }
 
-        VkCommandBuffer command_buffer;
-        vkAllocateCommandBuffers(device_,
-                                 std::addressof(alloc_info),
-                                 std::addressof(command_buffer));
+    auto create_parallel_recorder_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_parallel_recorder");
+        auto indices = find_queue_families_(physical_device_);
+        // one slice per worker is plenty, past that pools cost more than
+        // they save for draw lists of this size
+        auto& workers     = jobs::global_scheduler();
+        const auto slices = std::min(workers.worker_count(), 8u);
+        recorder_.emplace(device_,
+                          indices.graphics_family.value(),
+                          frames_in_flight_,
+                          workers,
+                          slices);
+        log("recording command buffers in up to {} slices on {} workers",
+            slices,
+            workers.worker_count());
+    }
 
-        VkCommandBufferBeginInfo begin_info{
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        };
+    // cpu work of a frame between the frame slot wait and the queue submit,
+    // nodes without a path between them run concurrently; queue submits and
+    // presents stay on the calling thread
+    auto create_frame_graph_()
+    {
+        frame_graph_.add("vk::uploads", [this] {
+            staging_->retire();
+            staging_->flush();
+        });
+        // the gpu culls indirect draws itself
+        const auto cull = frame_graph_.add("vk::cull", [this] {
+            if (not draws_indirect()) {
+                culling::cull(view_frustum_, draw_bounds_, visible_draws_);
+            }
+        });
+        const auto record = frame_graph_.add("vk::record", [this] {
+            vkResetCommandBuffer(command_buffers_.at(current_frame_), 0);
+            record_command_buffer_(command_buffers_.at(current_frame_),
+                                   frame_image_index_);
+        });
+        frame_graph_.precede(cull, record);
+        frame_graph_.add("vk::ocean", [this] {
+            if (ocean_) {
+                simulate_ocean_frame_();
+            }
+        });
+    }
 
-        vkBeginCommandBuffer(command_buffer, std::addressof(begin_info));
-        VkBufferCopy copy_region{.size = size};
-        vkCmdCopyBuffer(command_buffer,
-                        src_buffer,
-                        dst_buffer,
-                        1,
-                        std::addressof(copy_region));
-        vkEndCommandBuffer(command_buffer);
-
-        VkSubmitInfo submit_info{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                                 .commandBufferCount = 1,
-                                 .pCommandBuffers =
-                                     std::addressof(command_buffer)};
-        vkQueueSubmit(graphics_queue_,
-                      1,
-                      std::addressof(submit_info),
-                      VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphics_queue_);
-        vkFreeCommandBuffers(device_,
-                             command_pool_,
-                             1,
-                             std::addressof(command_buffer));
+    auto ocean_seconds_() const
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - ocean_start_;
+        return std::chrono::duration<double>(elapsed).count();
     }
 
-    auto create_vertex_buffer_()
+    auto simulate_ocean_frame_()
     {
-        VkDeviceSize buffer_size =
-            sizeof(decltype(vertices)::value_type) * vertices.size();
+        auto* slot = static_cast<std::byte*>(ocean_buffer_memory_.mapped)
+                     + ocean_slot_offset(current_frame_);
+        ocean_->simulate(ocean_seconds_(),
+                         std::span{reinterpret_cast<ocean::sample*>(slot),
+                                   ocean_->sample_count()},
+                         jobs::global_scheduler());
+    }
 
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        create_buffer_(buffer_size,
-                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                           | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       staging_buffer,
-                       staging_buffer_memory);
-
-        void* data = nullptr;
-        vkMapMemory(device_,
-                    staging_buffer_memory,
-                    0,
-                    buffer_size,
-                    0,
-                    std::addressof(data));
-        std::memcpy(data, vertices.data(), to_uint32_t(buffer_size));
-        vkUnmapMemory(device_, staging_buffer_memory);
+    // 256 is the largest storage buffer offset alignment there is
+    auto ocean_slot_size_() const -> VkDeviceSize
+    {
+        constexpr VkDeviceSize alignment = 256;
+        const auto bytes = ocean_->sample_count() * sizeof(ocean::sample);
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    auto rebuild_draw_bounds_()
+    {
+        draw_bounds_.clear();
+        draw_bounds_.reserve(draw_list_.size());
+        for (const auto& draw : draw_list_) {
+            draw_bounds_.push({draw.bounds.x, draw.bounds.y, draw.depth},
+                              {draw.bounds.z, draw.bounds.w, draw.depth});
+        }
+    }
+
+    // every mesh is reordered for the vertex cache, overdraw and fetches
+    // before it is uploaded
+    auto optimize_mesh_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::optimize_mesh");
+        mesh_vertices_ = vertices;
+        mesh_indices_  = indices;
+        const auto before = mesh::analyze_vertex_cache(
+            std::span<const uint16_t>{mesh_indices_}, mesh_vertices_.size());
+        mesh::optimize(mesh_indices_, mesh_vertices_, [](const vertex& v) {
+            return glm::vec3{v.pos.unpack(), 0.f};
+        });
+        const auto after = mesh::analyze_vertex_cache(
+            std::span<const uint16_t>{mesh_indices_}, mesh_vertices_.size());
+        log<severity::debug>("mesh: acmr {:.3f} -> {:.3f}, atvr {:.3f} -> "
+                             "{:.3f}",
+                             before.acmr,
+                             after.acmr,
+                             before.atvr,
+                             after.atvr);
+    }
+
+    auto create_vertex_buffer_()
+    {
+        ANTARTAR_PROFILE_ZONE("vk::create_vertex_buffer");
+        VkDeviceSize buffer_size = std::span{mesh_vertices_}.size_bytes();
 
         create_buffer_(buffer_size,
                        VK_BUFFER_USAGE_TRANSFER_DST_BIT
@@ -1211,34 +2149,14 @@ template<typename WindowT> class vk {
                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                        vertex_buffer_,
                        vertex_buffer_memory_);
-
-        copy_buffer_(staging_buffer, vertex_buffer_, buffer_size);
-        vkDestroyBuffer(device_, staging_buffer, nullptr);
-        vkFreeMemory(device_, staging_buffer_memory, nullptr);
+        staging_->upload(
+            vertex_buffer_, 0, std::as_bytes(std::span{mesh_vertices_}));
     }
 
     auto create_index_buffer_()
     {
-        VkDeviceSize buffer_size =
-            sizeof(decltype(indices)::value_type) * indices.size();
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        create_buffer_(buffer_size,
-                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                           | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       staging_buffer,
-                       staging_buffer_memory);
-
-        void* data = nullptr;
-        vkMapMemory(device_,
-                    staging_buffer_memory,
-                    0,
-                    buffer_size,
-                    0,
-                    std::addressof(data));
-        std::memcpy(data, indices.data(), buffer_size);
-        vkUnmapMemory(device_, staging_buffer_memory);
+        ANTARTAR_PROFILE_ZONE("vk::create_index_buffer");
+        VkDeviceSize buffer_size = std::span{mesh_indices_}.size_bytes();
 
         create_buffer_(buffer_size,
                        VK_BUFFER_USAGE_TRANSFER_DST_BIT
@@ -1246,124 +2164,455 @@ template<typename WindowT> class vk {
                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                        index_buffer_,
                        index_buffer_memory_);
-        copy_buffer_(staging_buffer, index_buffer_, buffer_size);
-        vkDestroyBuffer(device_, staging_buffer, nullptr);
+        staging_->upload(
+            index_buffer_, 0, std::as_bytes(std::span{mesh_indices_}));
+    }
+
+    auto create_instance_buffer_(std::span<const instance> instances)
+    {
+        create_buffer_(instances.size_bytes(),
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT
+                           | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       instance_buffer_,
+                       instance_buffer_memory_);
+        staging_->upload(instance_buffer_, 0, std::as_bytes(instances));
     }
 
   public:
-    inline vk(WindowT& window) : window_{window}
+    inline vk(WindowT& window, const frame_pacing& policy = {})
+        : window_{window},
+          pacing_{policy},
+          frames_in_flight_{
+              std::clamp(policy.frames_in_flight, 1u, max_frames_in_flight)}
     {
+        ANTARTAR_PROFILE_ZONE("vk::vk");
+        using clock      = std::chrono::steady_clock;
+        const auto start = clock::now();
         create_vk_instance_();
         setup_debug_messenger_();
         create_surface_();
         pick_physical_device_();
         create_logical_device_();
+        create_memory_allocator_();
+        create_pipeline_cache_();
         create_swap_chain_();
         create_image_views_();
+        create_depth_resources_();
         create_render_pass_();
+        const auto pipelines_start = clock::now();
         create_graphics_pipeline_();
+        startup_timings_.pipelines = clock::now() - pipelines_start;
         create_framebuffers_();
         create_command_pool_();
+        create_parallel_recorder_();
+        create_staging_ring_();
+        create_gpu_profiler_();
+        optimize_mesh_();
         create_vertex_buffer_();
         create_index_buffer_();
+        create_instance_buffer_(std::array{instance{}});
+        // both uploads go to the gpu in one submit, the acquire on the graphics
+        // queue orders them before the first frame
+        staging_->flush();
         create_command_buffers_();
         create_sync_objects_();
+        create_deletion_queue_();
+        create_indirect_draws_();
+        create_readback_buffers_();
+        rebuild_draw_bounds_();
+        create_frame_graph_();
+        log("device memory: {}", allocator_->stats());
+        startup_timings_.total               = clock::now() - start;
+        startup_timings_.warm_pipeline_cache = pipeline_cache_->warm();
+        log("startup took {:.2f} ms, pipelines {:.2f} ms ({} pipeline cache)",
+            startup_timings_.total.count(),
+            startup_timings_.pipelines.count(),
+            startup_timings_.warm_pipeline_cache ? "warm" : "cold");
+        const auto effective = pacing();
+        log("frame pacing {}: {} frames in flight, present mode {}, "
+            "present wait {}",
+            latency_mode_name(effective.mode),
+            effective.frames_in_flight,
+            present_mode() ? present_mode_name(*present_mode()) : "none"sv,
+            effective.wait_for_present ? "on" : "off");
     }
 
     auto draw_frame()
     {
-        vkWaitForFences(device_,
-                        1,
-                        std::addressof(in_flight_fences_.at(current_frame_)),
-                        VK_TRUE,
-                        UINT64_MAX);
+        ANTARTAR_PROFILE_ZONE("vk::draw_frame");
+        using clock            = std::chrono::steady_clock;
+        const auto frame_start = clock::now();
+        frame_timings_         = {};
+        wait_for_frame_slot_();
+        deletions_->collect();
+        recorder_->reset(current_frame_);
         uint32_t image_index{};
-        VkResult result =
-            vkAcquireNextImageKHR(device_,
-                                  swap_chain_,
-                                  UINT64_MAX,
-                                  image_available_samphores_.at(current_frame_),
-                                  VK_NULL_HANDLE,
-                                  std::addressof(image_index));
-        if (one_of(result, VK_ERROR_OUT_OF_DATE_KHR)) {
-            recreate_swap_chain_();
-            return;
+        if constexpr (headless_) {
+            present_readback_(current_frame_);
+            image_index = current_frame_;
         }
-        else if (not one_of(result, VK_SUCCESS, VK_SUBOPTIMAL_KHR)) {
-            throw std::runtime_error("failed to acquire swap chain image!");
+        else {
+            VkResult result = vkAcquireNextImageKHR(
+                device_,
+                swap_chain_,
+                UINT64_MAX,
+                image_available_samphores_.at(current_frame_),
+                VK_NULL_HANDLE,
+                std::addressof(image_index));
+            if (one_of(result, VK_ERROR_OUT_OF_DATE_KHR)) {
+                recreate_swap_chain_();
+                return;
+            }
+            else if (not one_of(result, VK_SUCCESS, VK_SUBOPTIMAL_KHR)) {
+                throw std::runtime_error("failed to acquire swap chain image!");
+            }
+        }
+        const auto acquired    = clock::now();
+        frame_timings_.acquire = acquired - frame_start;
+
+        // reserved only once the frame is sure to be submitted
+        const auto frame_value = frame_timeline_->reserve();
+        frame_image_index_     = image_index;
+        frame_graph_.run(jobs::global_scheduler());
+        const auto recorded   = clock::now();
+        frame_timings_.record = recorded - acquired;
+
+        std::array<VkSemaphore, 1> wait_semaphores{};
+        std::array signal_semaphores = {frame_timeline_->handle(),
+                                        VkSemaphore{VK_NULL_HANDLE}};
+        if constexpr (not headless_) {
+            wait_semaphores.at(0) =
+                image_available_samphores_.at(current_frame_);
+            signal_semaphores.at(1) =
+                render_finished_semaphores_.at(current_frame_);
         }
-
-        vkResetFences(device_,
-                      1,
-                      std::addressof(in_flight_fences_.at(current_frame_)));
-
-        vkResetCommandBuffer(command_buffers_.at(current_frame_), 0);
-        record_command_buffer_(command_buffers_.at(current_frame_),
-                               image_index);
-
-        std::array wait_semaphores = {
-            image_available_samphores_.at(current_frame_)};
         std::array<VkPipelineStageFlags, 1> wait_stages = {
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        std::array signal_semaphores = {
-            render_finished_semaphores_.at(current_frame_)};
+        // values of binary semaphores are ignored
+        std::array<uint64_t, 1> wait_values{};
+        std::array<uint64_t, 2> signal_values{frame_value, 0};
+        // offscreen images are never acquired nor presented
+        const auto swap_chain_semaphores = headless_ ? 0u : 1u;
+        VkTimelineSemaphoreSubmitInfo timeline_info{
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .waitSemaphoreValueCount   = swap_chain_semaphores,
+            .pWaitSemaphoreValues      = wait_values.data(),
+            .signalSemaphoreValueCount = 1 + swap_chain_semaphores,
+            .pSignalSemaphoreValues    = signal_values.data()};
         VkSubmitInfo submit_info{
             .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .waitSemaphoreCount = wait_semaphores.size(),
+            .pNext              = std::addressof(timeline_info),
+            .waitSemaphoreCount = swap_chain_semaphores,
             .pWaitSemaphores    = wait_semaphores.data(),
             .pWaitDstStageMask  = wait_stages.data(),
             .commandBufferCount = 1,
             .pCommandBuffers =
                 std::addressof(command_buffers_.at(current_frame_)),
-            .signalSemaphoreCount = signal_semaphores.size(),
+            .signalSemaphoreCount = 1 + swap_chain_semaphores,
             .pSignalSemaphores    = signal_semaphores.data()};
         if (not equals(VK_SUCCESS,
                        vkQueueSubmit(graphics_queue_,
                                      1,
                                      std::addressof(submit_info),
-                                     in_flight_fences_.at(current_frame_)))) {
+                                     VK_NULL_HANDLE))) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        const auto submitted  = clock::now();
+        frame_timings_.submit = submitted - recorded;
+
+        if constexpr (headless_) {
+            readback_pending_.at(current_frame_) = window_.get().readback();
+        }
+        else {
+            std::array swap_chains{swap_chain_};
+            const auto present_id = next_present_id_++;
+            present_starts_.at(present_id % tracked_presents) = frame_start;
+            VkPresentIdKHR present_ids{
+                .sType          = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+                .swapchainCount = swap_chains.size(),
+                .pPresentIds    = std::addressof(present_id)};
+
+            VkPresentInfoKHR present_info{
+                .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+                .pNext = wait_for_present_ ? std::addressof(present_ids)
+                                           : nullptr,
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores    = std::addressof(signal_semaphores.at(1)),
+                .swapchainCount     = swap_chains.size(),
+                .pSwapchains        = swap_chains.data(),
+                .pImageIndices      = std::addressof(image_index),
+                .pResults           = nullptr};
+            auto result =
+                vkQueuePresentKHR(present_queue_, std::addressof(present_info));
+            if (one_of(result, VK_ERROR_OUT_OF_DATE_KHR, VK_SUBOPTIMAL_KHR)
+                or frame_buffer_resized_) {
+                frame_buffer_resized_ = false;
+                recreate_swap_chain_();
+            }
+            else if (not equals(result, VK_SUCCESS)) {
+                throw std::runtime_error("failed to present swap chain image!");
+            }
+            // blocking on the oldest frame in flight keeps the queue to the
+            // display frames_in_flight deep
+            collect_presents_(
+                pacing_.wait_for_present
+                    ? std::max<uint64_t>(present_id + 1, frames_in_flight_)
+                          - frames_in_flight_
+                    : 0);
+        }
+        frame_timings_.present = clock::now() - submitted;
+
+        current_frame_ = modulo_increment(current_frame_, frames_in_flight_);
+    }
+
+    auto wait_idle()
+    {
+        vkDeviceWaitIdle(device_);
+        if constexpr (headless_) {
+            // oldest frame first
+            for (uint32_t i = 0; i < frames_in_flight_; ++i) {
+                present_readback_((current_frame_ + i) % frames_in_flight_);
+            }
+        }
+    }
+
+    auto memory_statistics() const { return allocator_->stats(); }
+
+    auto startup() const { return startup_timings_; }
+
+    auto last_frame_timings() const { return frame_timings_; }
+
+    // the policy in effect, frames in flight clamped and present wait only
+    // when the device supports it
+    auto pacing() const
+    {
+        auto effective             = pacing_;
+        effective.frames_in_flight = frames_in_flight_;
+        effective.wait_for_present =
+            pacing_.wait_for_present and wait_for_present_ != nullptr;
+        return effective;
+    }
+
+    // nullopt when headless, nothing is presented
+    auto present_mode() const -> std::optional<VkPresentModeKHR>
+    {
+        if constexpr (headless_) {
+            return std::nullopt;
+        }
+        else {
+            return present_mode_;
+        }
+    }
+
+    // gpu time of render pass zones, lags frames in flight frames behind
+    auto gpu_frame_timings() const
+    {
+        return gpu_profiler_ ? gpu_profiler_->results()
+                             : std::span<const gpu_profiler::zone_result>{};
+    }
+
+    // gpu time spent on upload copies retired since the previous call
+    auto take_gpu_upload_milliseconds()
+    {
+        return staging_->take_gpu_milliseconds();
+    }
+
+    // uploads overlap rendering, wait on a flushed ticket before reusing the
+    // destination buffer
+    auto& uploads() { return *staging_; }
+
+    // the quad drawn once per instance; instanced issues a single draw,
+    // otherwise every instance gets its own, only useful for comparison
+    auto set_instances(std::span<const instance> instances,
+                       bool instanced = true)
+    {
+        ANTARTAR_PROFILE_ZONE("vk::set_instances");
+        if (instances.empty()) {
+            throw std::runtime_error(log_message("no instances to draw"sv));
+        }
+        deletions_->retire(instance_buffer_, instance_buffer_memory_);
+        create_instance_buffer_(instances);
+
+        const draw_item quad{.index_count   = to_uint32_t(indices.size()),
+                             .first_index   = 0,
+                             .vertex_offset = 0};
+        // the quad spans half a unit around the origin
+        auto bounds_of = [](const instance& i) {
+            const auto offset = glm::vec2{i.transform};
+            const auto extent = glm::vec2{i.transform.z, i.transform.w} * .5f;
+            return glm::vec4{offset - extent, offset + extent};
+        };
+        draw_list_.clear();
+        if (instanced) {
+            auto draw           = quad;
+            draw.instance_count = to_uint32_t(instances.size());
+            auto low            = glm::vec2{std::numeric_limits<float>::max()};
+            auto high           = -low;
+            draw.depth          = 1.f;
+            for (const auto& i : instances) {
+                const auto bounds = bounds_of(i);
+                low               = glm::min(low, glm::vec2{bounds});
+                high = glm::max(high, glm::vec2{bounds.z, bounds.w});
+                draw.depth = std::min(draw.depth, i.depth);
+            }
+            draw.bounds = {low, high};
+            draw_list_.push_back(draw);
+        }
+        else {
+            draw_list_.reserve(instances.size());
+            for (uint32_t i = 0; i < instances.size(); ++i) {
+                auto draw           = quad;
+                draw.first_instance = i;
+                draw.bounds         = bounds_of(instances[i]);
+                draw.depth          = instances[i].depth;
+                draw_list_.push_back(draw);
+            }
+        }
+        rebuild_draw_bounds_();
+        upload_indirect_draws_();
+    }
+
+    auto draw_calls() const { return draw_list_.size(); }
+
+    // simulates the ocean on the cpu from now on, every frame into its slot
+    // of ocean_buffer(); replaces the previous simulation
+    auto simulate_ocean(const ocean::parameters& parameters)
+    {
+        ANTARTAR_PROFILE_ZONE("vk::simulate_ocean");
+        ocean::simulation simulation{parameters};
+        deletions_->retire(ocean_buffer_, ocean_buffer_memory_);
+        ocean_.emplace(std::move(simulation));
+        create_buffer_(ocean_slot_size_() * frames_in_flight_,
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+                           | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                           | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       ocean_buffer_,
+                       ocean_buffer_memory_);
+        ocean_start_ = std::chrono::steady_clock::now();
+    }
+
+    auto simulates_ocean() const { return ocean_.has_value(); }
+
+    // ocean::sample per grid point row by row, one slot per frame in flight
+    auto ocean_buffer() const { return ocean_buffer_; }
 
-        std::array swap_chains{swap_chain_};
+    // where the frame's samples start in ocean_buffer()
+    auto ocean_slot_offset(uint32_t frame) const
+    {
+        return ocean_slot_size_() * frame;
+    }
 
-        VkPresentInfoKHR present_info{
-            .sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-            .waitSemaphoreCount = signal_semaphores.size(),
-            .pWaitSemaphores    = signal_semaphores.data(),
-            .swapchainCount     = swap_chains.size(),
-            .pSwapchains        = swap_chains.data(),
-            .pImageIndices      = std::addressof(image_index),
-            .pResults           = nullptr};
-        result =
-            vkQueuePresentKHR(present_queue_, std::addressof(present_info));
-        if (one_of(result, VK_ERROR_OUT_OF_DATE_KHR, VK_SUBOPTIMAL_KHR)
-            or frame_buffer_resized_) {
-            frame_buffer_resized_ = false;
-            recreate_swap_chain_();
+    // simulates the ocean on the device from now on and draws it instead of
+    // the scene, no surface data crosses the bus per frame; replaces the
+    // previous simulation, waiting for the device to be done with it
+    auto simulate_gpu_ocean(const ocean::parameters& parameters)
+    {
+        ANTARTAR_PROFILE_ZONE("vk::simulate_gpu_ocean");
+        if (gpu_ocean_) {
+            wait_idle();
+            gpu_ocean_.reset();
         }
-        else if (not equals(result, VK_SUCCESS)) {
-            throw std::runtime_error("failed to present swap chain image!");
+        const gpu_ocean::shaders modules{
+            .spectrum = load_shader_module_("ocean_spectrum.comp.spv"),
+            .fft      = load_shader_module_("ocean_fft.comp.spv"),
+            .surface  = load_shader_module_("ocean_surface.comp.spv"),
+            .vertex   = load_shader_module_("ocean.vert.spv"),
+            .fragment = load_shader_module_("ocean.frag.spv")};
+        gpu_ocean_.emplace(device_,
+                           physical_device_,
+                           *allocator_,
+                           *staging_,
+                           pipeline_cache_->handle(),
+                           render_pass_,
+                           modules,
+                           frames_in_flight_,
+                           parameters);
+        for (auto module : {modules.spectrum,
+                            modules.fft,
+                            modules.surface,
+                            modules.vertex,
+                            modules.fragment}) {
+            vkDestroyShaderModule(device_, module, nullptr);
         }
+        ocean_start_ = std::chrono::steady_clock::now();
+    }
+
+    auto simulates_gpu_ocean() const { return gpu_ocean_.has_value(); }
+
+    // the next frame copies its gpu ocean surface back, see
+    // gpu_ocean_capture
+    auto capture_gpu_ocean() { gpu_ocean_->request_capture(); }
+
+    // once the capturing frame completed
+    auto gpu_ocean_capture() const { return gpu_ocean_->captured(); }
+
+    auto gpu_ocean_parameters() const -> const ocean::parameters&
+    {
+        return gpu_ocean_->parameters();
+    }
+
+    // of the gpu ocean's quadtree nodes in the last recorded frame
+    auto gpu_ocean_vertices() const
+    {
+        return gpu_ocean_ ? gpu_ocean_->drawn_vertices() : 0u;
+    }
+
+    // indirect draws are on by default where supported, off records every
+    // draw on the cpu
+    auto set_indirect(bool enabled) { use_indirect_ = enabled; }
+
+    auto draws_indirect() const
+    {
+        return use_indirect_ and indirect_.has_value();
+    }
+
+    // indirect draws hidden behind the previous frame's depth are dropped,
+    // on by default; instanced draws only when all instances are hidden
+    auto set_occlusion(bool enabled) { use_occlusion_ = enabled; }
 
-        current_frame_ = modulo_increment(current_frame_, max_frames_in_flight);
+    auto culls_occluded() const { return draws_indirect() and use_occlusion_; }
+
+    auto draw_path() const
+    {
+        if (not draws_indirect()) {
+            return "direct"sv;
+        }
+        return indirect_->count_buffer() ? "indirect_count"sv : "indirect"sv;
     }
 
-    auto wait_idle() { vkDeviceWaitIdle(device_); }
+    // hand over resources frames in flight may still use instead of
+    // destroying them, they're freed once those frames completed
+    auto& deletions() { return *deletions_; }
 
     inline ~vk()
     {
+        deletions_.reset();
         cleanup_swap_chain_();
 
         vkDestroyPipeline(device_, graphics_pipeline_, nullptr);
         vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
         vkDestroyRenderPass(device_, render_pass_, nullptr);
-
-        vkDestroyBuffer(device_, index_buffer_, nullptr);
-        vkFreeMemory(device_, index_buffer_memory_, nullptr);
-
-        vkDestroyBuffer(device_, vertex_buffer_, nullptr);
-        vkFreeMemory(device_, vertex_buffer_memory_, nullptr);
+        pipeline_cache_.reset();
+        gpu_profiler_.reset();
+        recorder_.reset();
+        indirect_.reset();
+        depth_pyramid_.reset();
+        gpu_ocean_.reset();
+
+        staging_.reset();
+        for (const auto& [i, buffer] :
+             readback_buffers_ | ranges::views::enumerate) {
+            destroy_buffer_(buffer, readback_memory_.at(i));
+        }
+        if (ocean_buffer_ != VK_NULL_HANDLE) {
+            destroy_buffer_(ocean_buffer_, ocean_buffer_memory_);
+        }
+        destroy_buffer_(instance_buffer_, instance_buffer_memory_);
+        destroy_buffer_(index_buffer_, index_buffer_memory_);
+        destroy_buffer_(vertex_buffer_, vertex_buffer_memory_);
+        allocator_.reset();
 
         ranges::for_each(render_finished_semaphores_, [this](VkSemaphore s) {
             vkDestroySemaphore(device_, s, nullptr);
@@ -1371,15 +2620,15 @@ template<typename WindowT> class vk {
         ranges::for_each(image_available_samphores_, [this](VkSemaphore s) {
             vkDestroySemaphore(device_, s, nullptr);
         });
-        ranges::for_each(in_flight_fences_, [this](VkFence f) {
-            vkDestroyFence(device_, f, nullptr);
-        });
+        frame_timeline_.reset();
         vkDestroyCommandPool(device_, command_pool_, nullptr);
         vkDestroyDevice(device_, nullptr);
         if (enable_validation_layers) {
             DestroyDebugUtilsMessengerEXT(instance_, debug_messenger_, nullptr);
         }
-        vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        if constexpr (not headless_) {
+            vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        }
         vkDestroyInstance(instance_, nullptr);
     }
 
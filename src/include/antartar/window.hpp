@@ -3,6 +3,7 @@
 #include <antartar/log.hpp>
 #include <antartar/vk.hpp>
 #include <fmt/format.h>
+#include <span>
 #include <stdexcept>
 
 namespace antartar {
@@ -61,9 +62,12 @@ class window {
     vk::vk<scoped_glfw3_window> vulkan_;
 
   public:
-    inline window(auto width, auto height, const std::string& title)
+    inline window(auto width,
+                  auto height,
+                  const std::string& title,
+                  const vk::frame_pacing& pacing = {})
         : glfw_window_(width, height, title.c_str()),
-          vulkan_(glfw_window_)
+          vulkan_(glfw_window_, pacing)
     {
         glfwSetWindowUserPointer(glfw_window_, std::addressof(vulkan_));
         glfwSetFramebufferSizeCallback(glfw_window_,
@@ -74,6 +78,48 @@ class window {
 
     auto wait_idle() { vulkan_.wait_idle(); }
 
+    auto startup() const { return vulkan_.startup(); }
+
+    auto last_frame_timings() const { return vulkan_.last_frame_timings(); }
+
+    auto pacing() const { return vulkan_.pacing(); }
+
+    auto present_mode() const { return vulkan_.present_mode(); }
+
+    auto gpu_frame_timings() const { return vulkan_.gpu_frame_timings(); }
+
+    auto set_instances(std::span<const vk::instance> instances, bool instanced)
+    {
+        vulkan_.set_instances(instances, instanced);
+    }
+
+    auto draw_calls() const { return vulkan_.draw_calls(); }
+
+    auto set_indirect(bool enabled) { vulkan_.set_indirect(enabled); }
+
+    auto draw_path() const { return vulkan_.draw_path(); }
+
+    auto set_occlusion(bool enabled) { vulkan_.set_occlusion(enabled); }
+
+    auto culls_occluded() const { return vulkan_.culls_occluded(); }
+
+    auto simulate_ocean(const ocean::parameters& parameters)
+    {
+        vulkan_.simulate_ocean(parameters);
+    }
+
+    auto simulate_gpu_ocean(const ocean::parameters& parameters)
+    {
+        vulkan_.simulate_gpu_ocean(parameters);
+    }
+
+    auto gpu_ocean_vertices() const { return vulkan_.gpu_ocean_vertices(); }
+
+    auto take_gpu_upload_milliseconds()
+    {
+        return vulkan_.take_gpu_upload_milliseconds();
+    }
+
     operator GLFWwindow*() { return glfw_window_; }
 };
 } // namespace antartar
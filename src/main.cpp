@@ -1,15 +1,17 @@
 #include <antartar/app.hpp>
 #include <fmt/format.h>
 
-int main()
+int main(int argc, char** argv)
 {
     fmt::print("hello ocean of antartar\n");
 
     try {
-        antartar::app app;
+        antartar::app app{antartar::parse_options(
+            std::span<const char* const>{argv, static_cast<size_t>(argc)})};
         app.run();
     }
     catch (const std::exception& e) {
+        antartar::flush_log();
         fmt::print("{}\n", e.what());
         return EXIT_FAILURE;
     }